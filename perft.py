@@ -0,0 +1,225 @@
+"""
+Perft: move generation check for the C++ agent.
+
+Counts the positions reachable in exactly N plies from every position in a
+corpus, once with the C++ move generator (student_agent_module.perft_divide)
+and once with the authoritative rules in gameEngine.py (compute_valid_targets
++ validate_and_apply_move). The two are compared root move by root move, so a
+mismatch points at the exact move that diverges. The C++ speed is reported in
+nodes per second.
+
+Run it after every change to move generation:
+
+    python perft.py                      # whole corpus, depth from the corpus
+    python perft.py --depth 3 --no-reference   # C++ only, for timing
+    python perft.py --generate 4         # rebuild the corpus from random games
+"""
+
+import argparse
+import json
+import random
+import sys
+import time
+from typing import Any, Dict, List, Optional, Tuple
+
+import gameEngine as engine
+from gameEngine import Piece
+
+DEFAULT_CORPUS = "perft_corpus.json"
+
+MoveKey = Tuple[str, Tuple[int, int], Optional[Tuple[int, int]], Optional[Tuple[int, int]], Optional[str]]
+
+# ---------------- Board helpers ----------------
+def copy_board(board: List[List[Optional[Piece]]]) -> List[List[Optional[Piece]]]:
+    return [[cell.copy() if cell else None for cell in row] for row in board]
+
+def to_cpp_board(board: List[List[Optional[Piece]]]) -> List[List[Dict[str, str]]]:
+    """Same conversion as student_agent_cpp.StudentAgent.choose."""
+    cpp_board = []
+    for row in board:
+        cpp_row = []
+        for cell in row:
+            if cell is None:
+                cpp_row.append({})
+            else:
+                cpp_row.append({key: (value if value is not None else "") for key, value in cell.to_dict().items()})
+        cpp_board.append(cpp_row)
+    return cpp_board
+
+def move_key(move: Dict[str, Any]) -> MoveKey:
+    """Identifies a move independently of how it is spelled (dict from the engine or Move from C++)."""
+    action = move["action"]
+    to = tuple(move["to"]) if action in ("move", "push") else None
+    pushed_to = tuple(move["pushed_to"]) if action == "push" else None
+    orientation = move.get("orientation") if action == "flip" else None
+    return (action, tuple(move["from"]), to, pushed_to, orientation or None)
+
+def format_move(key: MoveKey) -> str:
+    action, fr, to, pushed_to, orientation = key
+    text = f"{action} {fr}"
+    if to: text += f" -> {to}"
+    if pushed_to: text += f" pushing to {pushed_to}"
+    if orientation: text += f" {orientation}"
+    return text
+
+# ---------------- Reference (gameEngine.py) ----------------
+def reference_moves(board, player: str, rows: int, cols: int, score_cols: List[int]) -> List[Tuple[Dict[str, Any], List[List[Optional[Piece]]]]]:
+    """Every move the engine would accept, with the board it leads to."""
+    candidates = []
+    for y in range(rows):
+        for x in range(cols):
+            piece = board[y][x]
+            if not piece or piece.owner != player:
+                continue
+            info = engine.compute_valid_targets(board, x, y, player, rows, cols, score_cols)
+            for to in info['moves']:
+                candidates.append({"action": "move", "from": [x, y], "to": list(to)})
+            for to, pushed_to in info['pushes']:
+                candidates.append({"action": "push", "from": [x, y], "to": list(to), "pushed_to": list(pushed_to)})
+            if piece.side == "stone":
+                for orientation in ("horizontal", "vertical"):
+                    candidates.append({"action": "flip", "from": [x, y], "orientation": orientation})
+            else:
+                candidates.append({"action": "flip", "from": [x, y]})
+                candidates.append({"action": "rotate", "from": [x, y]})
+
+    legal = []
+    for move in candidates:
+        next_board = copy_board(board)
+        ok, _ = engine.validate_and_apply_move(next_board, move, player, rows, cols, score_cols)
+        if ok:
+            legal.append((move, next_board))
+    return legal
+
+def reference_perft(board, player: str, rows: int, cols: int, score_cols: List[int], depth: int) -> int:
+    if depth == 0:
+        return 1
+    if engine.check_win(board, rows, cols, score_cols):
+        return 0
+    moves = reference_moves(board, player, rows, cols, score_cols)
+    if depth == 1:
+        return len(moves)
+    return sum(reference_perft(next_board, engine.opponent(player), rows, cols, score_cols, depth - 1)
+               for _, next_board in moves)
+
+def reference_divide(board, player: str, rows: int, cols: int, score_cols: List[int], depth: int) -> Dict[MoveKey, int]:
+    if depth == 0 or engine.check_win(board, rows, cols, score_cols):
+        return {}
+    return {move_key(move): reference_perft(next_board, engine.opponent(player), rows, cols, score_cols, depth - 1)
+            for move, next_board in reference_moves(board, player, rows, cols, score_cols)}
+
+# ---------------- C++ ----------------
+def cpp_divide(module, board, player: str, rows: int, cols: int, score_cols: List[int], depth: int) -> Tuple[Dict[MoveKey, int], float]:
+    cpp_board = to_cpp_board(board)
+    start = time.perf_counter()
+    result = module.perft_divide(cpp_board, rows, cols, score_cols, player, depth)
+    elapsed = time.perf_counter() - start
+    divide: Dict[MoveKey, int] = {}
+    for move, nodes in result:
+        key = move_key({"action": move.action, "from": move.from_pos, "to": move.to_pos,
+                        "pushed_to": move.pushed_to, "orientation": move.orientation})
+        if key in divide:
+            print(f"    duplicate C++ move: {format_move(key)}")
+        divide[key] = divide.get(key, 0) + nodes
+    return divide, elapsed
+
+# ---------------- Corpus ----------------
+def load_corpus(path: str) -> List[Dict[str, Any]]:
+    """Each entry: name, player to move, depth, and a board in save_board_to_file's format."""
+    with open(path, "r", encoding="utf-8") as fh:
+        data = json.load(fh)
+    positions = []
+    for entry in data["positions"]:
+        board = [[Piece.from_dict(cell) if cell else None for cell in row] for row in entry["board"]]
+        positions.append({"name": entry["name"], "player": entry["player"], "depth": entry["depth"], "board": board})
+    return positions
+
+def save_corpus(path: str, positions: List[Dict[str, Any]]) -> None:
+    data = {"positions": [{"name": p["name"], "player": p["player"], "depth": p["depth"],
+                           "board": [[cell.to_dict() if cell else None for cell in row] for row in p["board"]]}
+                          for p in positions]}
+    with open(path, "w", encoding="utf-8") as fh:
+        json.dump(data, fh, indent=1)
+
+def generate_corpus(per_size: int, seed: int) -> List[Dict[str, Any]]:
+    """Start positions plus positions from random games, biased towards flips so rivers appear."""
+    rng = random.Random(seed)
+    positions = []
+    for rows, cols, size in ((13, 12, "small"), (15, 14, "medium"), (17, 16, "large")):
+        score_cols = engine.score_cols_for(cols)
+        positions.append({"name": f"{size}-start", "player": "circle", "depth": 2,
+                          "board": engine.default_start_board(rows, cols)})
+        game = 0
+        while sum(1 for p in positions if p["name"].startswith(size + "-game")) < per_size:
+            # One position per game, taken at a random ply
+            board = engine.default_start_board(rows, cols)
+            player = "circle"
+            target_ply = rng.randint(15, 60)
+            for ply in range(1, target_ply + 1):
+                moves = reference_moves(board, player, rows, cols, score_cols)
+                if not moves or engine.check_win(board, rows, cols, score_cols):
+                    break
+                flips = [m for m in moves if m[0]["action"] == "flip"]
+                _, board = rng.choice(flips) if flips and rng.random() < 0.3 else rng.choice(moves)
+                player = engine.opponent(player)
+                if ply == target_ply:
+                    positions.append({"name": f"{size}-game{game}-ply{ply}", "player": player, "depth": 2,
+                                      "board": board})
+            game += 1
+    return positions
+
+# ---------------- Main ----------------
+def main() -> int:
+    ap = argparse.ArgumentParser(description="Perft check of the C++ move generator against gameEngine.py")
+    ap.add_argument("--corpus", default=DEFAULT_CORPUS)
+    ap.add_argument("--depth", type=int, default=None, help="override the depth stored with each position")
+    ap.add_argument("--no-reference", action="store_true", help="only run (and time) the C++ generator")
+    ap.add_argument("--generate", type=int, metavar="N", help="rewrite the corpus with N random-game positions per board size")
+    ap.add_argument("--seed", type=int, default=1)
+    args = ap.parse_args()
+
+    if args.generate:
+        save_corpus(args.corpus, generate_corpus(args.generate, args.seed))
+        return 0
+
+    import build.student_agent_module as student_agent
+
+    total_nodes = 0
+    total_time = 0.0
+    failures = 0
+    for position in load_corpus(args.corpus):
+        board = position["board"]
+        rows, cols = len(board), len(board[0])
+        score_cols = engine.score_cols_for(cols)
+        player = position["player"]
+        depth = args.depth if args.depth is not None else position["depth"]
+
+        cpp, elapsed = cpp_divide(student_agent, board, player, rows, cols, score_cols, depth)
+        nodes = sum(cpp.values())
+        total_nodes += nodes
+        total_time += elapsed
+        line = f"{position['name']:<24} {rows}x{cols} {player:<6} depth {depth}: {nodes:>10} nodes  {nodes / max(elapsed, 1e-9):>12,.0f} nps"
+
+        if args.no_reference:
+            print(line)
+            continue
+
+        ref = reference_divide(board, player, rows, cols, score_cols, depth)
+        if cpp == ref:
+            print(line + "  OK")
+            continue
+
+        failures += 1
+        print(line + f"  MISMATCH (engine: {sum(ref.values())})")
+        for key in sorted(set(cpp) | set(ref), key=str):
+            if cpp.get(key) != ref.get(key):
+                print(f"    {format_move(key):<48} C++ {cpp.get(key, '-'):>8}   engine {ref.get(key, '-'):>8}")
+
+    print(f"total: {total_nodes} nodes in {total_time:.3f}s = {total_nodes / max(total_time, 1e-9):,.0f} nps")
+    if failures:
+        print(f"{failures} position(s) differ from gameEngine.py")
+        return 1
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,6 +1,7 @@
 // friend_agent.cpp
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include <algorithm>
 #include <chrono>
 #include <limits>
@@ -22,9 +23,20 @@
 #include <set> 
 #include <cmath>
 #include <memory>  
+#include <tuple>
 #include <climits>
 #include <numeric>
 #include <cstdint>
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 namespace py = pybind11;
 
 
@@ -48,143 +60,354 @@ struct Piece {
     inline bool isEmpty() const { return player == Player::NONE; }
 };
 
-// The "fast" board representation used by all internal search and eval functions.
-using FastBoard = std::vector<std::vector<Piece>>;
+// ---- Bitboard Board Representation ----
 
+// Cells are addressed as y * MAX_COLS + x for every board size, so the largest
+// board (17x16 = 272 cells) fits in a fixed number of 64-bit words.
+constexpr int MAX_ROWS = 17;
+constexpr int MAX_COLS = 16;
+constexpr int MAX_CELLS = MAX_ROWS * MAX_COLS;
 
-// ---- UTILITY FUNCTIONS ----
+constexpr int cell_index(int x, int y) { return y * MAX_COLS + x; }
+constexpr int cell_x(int idx) { return idx % MAX_COLS; }
+constexpr int cell_y(int idx) { return idx / MAX_COLS; }
 
-// Converts string_view to Player enum
-inline Player playerFromStr(std::string_view s) {
-    return (s == "square") ? Player::SQUARE : Player::CIRCLE;
-}
+/**
+ * @brief A 272-bit set of board cells, one bit per cell index.
+ */
+struct Bitboard {
+    static constexpr int WORDS = (MAX_CELLS + 63) / 64;
+    std::array<uint64_t, WORDS> words {};
+
+    constexpr void set(int idx) { words[idx >> 6] |= (uint64_t{1} << (idx & 63)); }
+    constexpr void reset(int idx) { words[idx >> 6] &= ~(uint64_t{1} << (idx & 63)); }
+    constexpr bool test(int idx) const { return (words[idx >> 6] >> (idx & 63)) & 1; }
+
+    inline bool any() const {
+        uint64_t acc = 0;
+        for (uint64_t w : words) acc |= w;
+        return acc != 0;
+    }
+    inline int count() const {
+        int n = 0;
+        for (uint64_t w : words) n += __builtin_popcountll(w);
+        return n;
+    }
 
-// Returns the opponent Player enum
-inline Player opponent(Player p) {
-    return (p == Player::SQUARE) ? Player::CIRCLE : Player::SQUARE;
-}
+    constexpr Bitboard& operator|=(const Bitboard& o) { for (int i = 0; i < WORDS; ++i) words[i] |= o.words[i]; return *this; }
+    constexpr Bitboard& operator&=(const Bitboard& o) { for (int i = 0; i < WORDS; ++i) words[i] &= o.words[i]; return *this; }
+    constexpr Bitboard& operator^=(const Bitboard& o) { for (int i = 0; i < WORDS; ++i) words[i] ^= o.words[i]; return *this; }
+    friend constexpr Bitboard operator|(Bitboard a, const Bitboard& b) { return a |= b; }
+    friend constexpr Bitboard operator&(Bitboard a, const Bitboard& b) { return a &= b; }
+    friend constexpr Bitboard operator^(Bitboard a, const Bitboard& b) { return a ^= b; }
+    inline bool operator==(const Bitboard& o) const { return words == o.words; }
+    inline bool operator!=(const Bitboard& o) const { return words != o.words; }
+    inline Bitboard without(const Bitboard& o) const {
+        Bitboard r;
+        for (int i = 0; i < WORDS; ++i) r.words[i] = words[i] & ~o.words[i];
+        return r;
+    }
 
-// Legacy opponent function
-constexpr std::string_view opponent(std::string_view p) {
-    return (p == "square") ? "circle" : "square";
-}
+    // Calls f(idx) for every set cell, in increasing index order (row-major).
+    template <typename F>
+    inline void for_each(F&& f) const {
+        for (int i = 0; i < WORDS; ++i) {
+            uint64_t w = words[i];
+            while (w) {
+                f((i << 6) + __builtin_ctzll(w));
+                w &= w - 1;
+            }
+        }
+    }
+};
 
-inline int top_score_row() { return 2; }
-inline int bottom_score_row(int rows) { return rows - 3; }
+// Piece states, shared with the Zobrist table:
+// 0: Empty
+// 1: Square Stone, 2: Square River H, 3: Square River V
+// 4: Circle Stone, 5: Circle River H, 6: Circle River V
+constexpr int NUM_PIECE_CODES = 7;
+enum PieceCode : uint8_t {
+    EMPTY = 0,
+    SQUARE_STONE = 1, SQUARE_RIVER_H = 2, SQUARE_RIVER_V = 3,
+    CIRCLE_STONE = 4, CIRCLE_RIVER_H = 5, CIRCLE_RIVER_V = 6
+};
 
-// Returns the row where the player wins.
-// Square moves DOWN to the bottom. Circle moves UP to the top.
-inline int get_target_row(Player player, int rows) {
-    return (player == Player::SQUARE) ? bottom_score_row(rows) : top_score_row();
+inline uint8_t piece_code(const Piece& piece) {
+    if (piece.isEmpty()) return EMPTY;
+    const uint8_t base = (piece.player == Player::SQUARE) ? SQUARE_STONE : CIRCLE_STONE;
+    if (piece.side == Side::STONE) return base;
+    return base + ((piece.orientation == Orientation::HORIZONTAL) ? 1 : 2);
 }
 
-// Returns the row where the opponent wins (the row we must defend).
-inline int get_defense_row(Player player, int rows) {
-    return (player == Player::SQUARE) ? top_score_row() : bottom_score_row(rows);
+inline Piece piece_from_code(uint8_t code) {
+    static constexpr std::array<Piece, NUM_PIECE_CODES> PIECES = {{
+        {Player::NONE, Side::STONE, Orientation::NONE},
+        {Player::SQUARE, Side::STONE, Orientation::NONE},
+        {Player::SQUARE, Side::RIVER, Orientation::HORIZONTAL},
+        {Player::SQUARE, Side::RIVER, Orientation::VERTICAL},
+        {Player::CIRCLE, Side::STONE, Orientation::NONE},
+        {Player::CIRCLE, Side::RIVER, Orientation::HORIZONTAL},
+        {Player::CIRCLE, Side::RIVER, Orientation::VERTICAL},
+    }};
+    return PIECES[code];
 }
 
-inline bool within_board_limits(int x, int y, int rows, int cols) {
-    if (x < 0 || y < 0) return false;
-    if (x >= cols || y >= rows) return false;
-    return true;
-}
+inline uint8_t stone_code(Player player) { return (player == Player::SQUARE) ? SQUARE_STONE : CIRCLE_STONE; }
+
+/**
+ * @brief The "fast" board representation used by all internal search and eval functions.
+ *
+ * One bitboard per piece state (indexed like the Zobrist table) plus a byte
+ * mailbox mirror for O(1) "what is on this cell" lookups. The whole board is a
+ * flat, trivially copyable value: no heap allocation.
+ */
+class FastBoard {
+public:
+    FastBoard() = default;
+    FastBoard(int rows, int cols) : rows(rows), cols(cols) {
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < cols; ++x) {
+                pieces[EMPTY].set(cell_index(x, y));
+            }
+        }
+    }
 
+    inline uint8_t code_at(int idx) const { return codes[idx]; }
+    inline Piece at(int x, int y) const { return piece_from_code(codes[cell_index(x, y)]); }
+    inline Piece at(int idx) const { return piece_from_code(codes[idx]); }
+    inline bool is_empty(int idx) const { return codes[idx] == EMPTY; }
 
-inline bool is_player_scoring_slot(
-    int x, int y,
-    Player player,
-    int rows, int cols,
-    const std::vector<int>& scoring_columns
-) {
-    
-    // Get the correct target row for this player
-    int scoring_row = get_target_row(player, rows);
+    // Replaces whatever is on idx with the given piece state.
+    inline void put(int idx, uint8_t code) {
+        pieces[codes[idx]].reset(idx);
+        pieces[code].set(idx);
+        codes[idx] = code;
+    }
 
-    // Must be on the correct row
-    if (y != scoring_row) {
-        return false;
+    inline Bitboard stones(Player player) const {
+        return pieces[stone_code(player)];
+    }
+    inline Bitboard rivers(Player player) const {
+        const uint8_t base = stone_code(player);
+        return pieces[base + 1] | pieces[base + 2];
+    }
+    inline Bitboard all_rivers() const {
+        return pieces[SQUARE_RIVER_H] | pieces[SQUARE_RIVER_V] | pieces[CIRCLE_RIVER_H] | pieces[CIRCLE_RIVER_V];
+    }
+    inline Bitboard pieces_of(Player player) const {
+        const uint8_t base = stone_code(player);
+        return pieces[base] | pieces[base + 1] | pieces[base + 2];
+    }
+    inline Bitboard occupied() const {
+        return pieces_of(Player::SQUARE) | pieces_of(Player::CIRCLE);
     }
 
-    // Then verify column membership
-    return std::find(scoring_columns.begin(), scoring_columns.end(), x) != scoring_columns.end();
-}
+    int rows {0};
+    int cols {0};
+    std::array<Bitboard, NUM_PIECE_CODES> pieces {};
+    std::array<uint8_t, MAX_CELLS> codes {};
+};
 
-bool rival_score_area(int x, int y, Player player, int rows, int cols, const std::vector<int>& score_cols) {
 
-    // The "rival score area" is the row the OPPONENT scores in
-    const int target_row = get_defense_row(player, rows);
-    return (y == target_row) && (std::find(score_cols.begin(), score_cols.end(), x) != score_cols.end());
-}
+// ---- UTILITY FUNCTIONS ----
 
-std::vector<std::pair<int, int>> opponent_scoring_areas(Player player, int rows, int cols, const std::vector<int>& score_cols) {
-    
-    // The "opponent scoring area" is the row the OPPONENT scores in
-    const int y = get_defense_row(player, rows);
-    std::vector<std::pair<int, int>> result;
-    result.reserve(score_cols.size());
-    for (int col : score_cols) {
-        result.push_back(std::make_pair(col, y));
-    }
-    return result;
+// Converts string_view to Player enum
+inline Player playerFromStr(std::string_view s) {
+    return (s == "square") ? Player::SQUARE : Player::CIRCLE;
 }
 
-std::vector<std::pair<int, int>> own_scoring_areas(Player player, int rows, int cols, const std::vector<int>& score_cols) {
-    
-    // The "own scoring area" is the row THIS player scores in
-    const int y = get_target_row(player, rows);
-    
-    std::vector<std::pair<int, int>> result;
-    result.reserve(score_cols.size());
-    for (int col : score_cols) {
-        result.push_back(std::make_pair(col, y));
-    }
-    return result;
+// Returns the opponent Player enum
+inline Player opponent(Player p) {
+    return (p == Player::SQUARE) ? Player::CIRCLE : Player::SQUARE;
 }
 
-inline int distance_to_own_scoring_area(int x, int y, Player player, int rows, int cols, const std::vector<int>& score_cols) {
-    // Decide the target row based on player
-    
-    // Clamp target x within scoring columns
-    int right_bound = *std::max_element(score_cols.begin(), score_cols.end());
-    int left_bound  = *std::min_element(score_cols.begin(), score_cols.end());
-    int target_x    = std::clamp(x, left_bound, right_bound);
-    
-    
-    // Get the correct scoring row for this player
-    const int scoring_y = get_target_row(player, rows);
-
-    // Manhattan distance
-    return std::abs(x - target_x) + std::abs(y - scoring_y);
+// Legacy opponent function
+constexpr std::string_view opponent(std::string_view p) {
+    return (p == "square") ? "circle" : "square";
 }
 
+// Index of a player in per-player tables
+constexpr int player_slot(Player player) { return (player == Player::SQUARE) ? 0 : 1; }
+
 // ----  Board Conversion Function ----
 /**
  * @brief Converts the slow, string-based Python board to our fast, struct-based board.
  * This is called ONCE per turn.
  */
 FastBoard convert_pyboard_to_fastboard(const Board& py_board, int rows, int cols) {
-    FastBoard new_board(rows, std::vector<Piece>(cols));
+    FastBoard new_board(rows, cols);
     for (int y = 0; y < rows; ++y) {
         for (int x = 0; x < cols; ++x) {
             const auto& cell = py_board[y][x];
-            if (cell.empty()) continue; // Default Piece is already Player::NONE
+            if (cell.empty()) continue; // Cell already starts out EMPTY
             
-            new_board[y][x].player = playerFromStr(cell.at("owner"));
+            Piece piece;
+            piece.player = playerFromStr(cell.at("owner"));
             if (cell.at("side") == "river") {
-                new_board[y][x].side = Side::RIVER;
-                new_board[y][x].orientation = (cell.at("orientation") == "horizontal") ? Orientation::HORIZONTAL : Orientation::VERTICAL;
+                piece.side = Side::RIVER;
+                piece.orientation = (cell.at("orientation") == "horizontal") ? Orientation::HORIZONTAL : Orientation::VERTICAL;
             } else {
-                new_board[y][x].side = Side::STONE;
-                new_board[y][x].orientation = Orientation::NONE;
+                piece.side = Side::STONE;
+                piece.orientation = Orientation::NONE;
             }
+            new_board.put(cell_index(x, y), piece_code(piece));
+        }
+    }
+    return new_board;
+}
+
+/**
+ * @brief Same as convert_pyboard_to_fastboard for a board already encoded as
+ * rows * cols piece codes (row-major), as in the batch evaluation API.
+ */
+FastBoard convert_codes_to_fastboard(const uint8_t* codes, int rows, int cols) {
+    FastBoard new_board(rows, cols);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            const uint8_t code = codes[y * cols + x];
+            if (code != EMPTY) new_board.put(cell_index(x, y), code);
         }
     }
     return new_board;
 }
 
+// ---- Board Geometry ----
+/**
+ * @brief Compile-time shape of one of the three supported boards.
+ *
+ * The engine is instantiated once per geometry, so everything the hot loops
+ * ask about the board shape (bounds, score cells, distance to goal) is a
+ * constant or a lookup into a constexpr table. Score columns are the centred
+ * block of 4/5/6 columns the game engine uses for 12/14/16 columns.
+ * Square scores on the bottom score row, Circle on the top one.
+ */
+template <int ROWS, int COLS>
+struct BoardGeometry {
+    static constexpr int rows = ROWS;
+    static constexpr int cols = COLS;
+    static constexpr int score_width = (COLS <= 12) ? 4 : ((COLS <= 14) ? 5 : 6);
+    static constexpr int score_left = (COLS - score_width) / 2;
+    static constexpr int score_right = score_left + score_width - 1;
+    static constexpr int top_score_row = 2;
+    static constexpr int bottom_score_row = ROWS - 3;
+
+    static constexpr bool in_bounds(int x, int y) { return x >= 0 && y >= 0 && x < COLS && y < ROWS; }
+    static constexpr bool is_score_col(int x) { return x >= score_left && x <= score_right; }
+
+    // Row where the player wins / row the player must defend.
+    static constexpr int target_row(Player player) { return (player == Player::SQUARE) ? bottom_score_row : top_score_row; }
+    static constexpr int defense_row(Player player) { return (player == Player::SQUARE) ? top_score_row : bottom_score_row; }
+
+    static constexpr Bitboard score_row_mask(int row) {
+        Bitboard mask;
+        for (int x = score_left; x <= score_right; ++x) mask.set(cell_index(x, row));
+        return mask;
+    }
+    static constexpr Bitboard TOP_SCORE_MASK = score_row_mask(top_score_row);
+    static constexpr Bitboard BOTTOM_SCORE_MASK = score_row_mask(bottom_score_row);
+    static constexpr Bitboard SCORE_MASKS = TOP_SCORE_MASK | BOTTOM_SCORE_MASK;
+
+    // Score cells the player wins on / the cells the OPPONENT scores in.
+    static constexpr const Bitboard& own_score_mask(Player player) { return (player == Player::SQUARE) ? BOTTOM_SCORE_MASK : TOP_SCORE_MASK; }
+    static constexpr const Bitboard& rival_score_mask(Player player) { return (player == Player::SQUARE) ? TOP_SCORE_MASK : BOTTOM_SCORE_MASK; }
+    static constexpr bool is_own_score_cell(int idx, Player player) { return own_score_mask(player).test(idx); }
+
+    // Score cells plus every cell touching them, diagonals included.
+    static constexpr Bitboard score_zone_mask(int row) {
+        Bitboard mask;
+        for (int y = row - 1; y <= row + 1; ++y) {
+            for (int x = score_left - 1; x <= score_right + 1; ++x) mask.set(cell_index(x, y));
+        }
+        return mask;
+    }
+    static constexpr Bitboard TOP_SCORE_ZONE = score_zone_mask(top_score_row);
+    static constexpr Bitboard BOTTOM_SCORE_ZONE = score_zone_mask(bottom_score_row);
+    static constexpr const Bitboard& own_score_zone(Player player) { return (player == Player::SQUARE) ? BOTTOM_SCORE_ZONE : TOP_SCORE_ZONE; }
+    static constexpr bool is_rival_score_cell(int idx, Player player) { return rival_score_mask(player).test(idx); }
+
+    // Manhattan distance from every cell to the nearest of the player's score cells.
+    static constexpr std::array<std::array<uint8_t, MAX_CELLS>, 2> make_goal_distance() {
+        std::array<std::array<uint8_t, MAX_CELLS>, 2> table {};
+        for (Player player : {Player::SQUARE, Player::CIRCLE}) {
+            for (int y = 0; y < ROWS; ++y) {
+                for (int x = 0; x < COLS; ++x) {
+                    const int target_x = (x < score_left) ? score_left : ((x > score_right) ? score_right : x);
+                    const int dx = x - target_x;
+                    const int dy = y - target_row(player);
+                    table[player_slot(player)][cell_index(x, y)] = static_cast<uint8_t>((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy));
+                }
+            }
+        }
+        return table;
+    }
+    static constexpr auto GOAL_DISTANCE = make_goal_distance();
+    static constexpr int distance_to_goal(int idx, Player player) { return GOAL_DISTANCE[player_slot(player)][idx]; }
+
+    // Cells next to a player's score cells: the rows above and below them, then
+    // their left and right neighbours. Score rows are never on the board edge.
+    static constexpr std::array<std::array<int, 2 * score_width + 2>, 2> make_score_zone_neighbours() {
+        std::array<std::array<int, 2 * score_width + 2>, 2> table {};
+        for (Player player : {Player::SQUARE, Player::CIRCLE}) {
+            const int scoring_row = target_row(player);
+            auto& cells = table[player_slot(player)];
+            int n = 0;
+            for (int x = score_left; x <= score_right; ++x) cells[n++] = cell_index(x, scoring_row - 1);
+            for (int x = score_left; x <= score_right; ++x) cells[n++] = cell_index(x, scoring_row + 1);
+            cells[n++] = cell_index(score_left - 1, scoring_row);
+            cells[n++] = cell_index(score_right + 1, scoring_row);
+        }
+        return table;
+    }
+    static constexpr auto SCORE_ZONE_NEIGHBOURS = make_score_zone_neighbours();
+
+    // True if score_cols (as passed in from Python) is the block this geometry assumes.
+    static bool matches(int rows_, int cols_, const std::vector<int>& score_cols) {
+        if (rows_ != ROWS || cols_ != COLS || static_cast<int>(score_cols.size()) != score_width) return false;
+        for (int i = 0; i < score_width; ++i) {
+            if (score_cols[i] != score_left + i) return false;
+        }
+        return true;
+    }
+};
+
+using SmallBoard = BoardGeometry<13, 12>;
+using MediumBoard = BoardGeometry<15, 14>;
+using LargeBoard = BoardGeometry<17, 16>;
+
+/**
+ * @brief Calls f(Geometry{}) with the geometry matching the board from Python.
+ * This is the only place board size is looked at at runtime.
+ */
+template <typename F>
+decltype(auto) dispatch_geometry(int rows, int cols, const std::vector<int>& score_cols, F&& f) {
+    if (SmallBoard::matches(rows, cols, score_cols)) return f(SmallBoard{});
+    if (MediumBoard::matches(rows, cols, score_cols)) return f(MediumBoard{});
+    if (LargeBoard::matches(rows, cols, score_cols)) return f(LargeBoard{});
+    throw std::invalid_argument("Unsupported board: " + std::to_string(rows) + "x" + std::to_string(cols));
+}
+
+// Same, for data written by this module that records only the board size.
+template <typename F>
+decltype(auto) dispatch_board_size(int rows, int cols, F&& f) {
+    if (rows == SmallBoard::rows && cols == SmallBoard::cols) return f(SmallBoard{});
+    if (rows == MediumBoard::rows && cols == MediumBoard::cols) return f(MediumBoard{});
+    if (rows == LargeBoard::rows && cols == LargeBoard::cols) return f(LargeBoard{});
+    throw std::invalid_argument("Unsupported board: " + std::to_string(rows) + "x" + std::to_string(cols));
+}
+
+// Index of a geometry among the supported boards, for per-size tables.
+constexpr int NUM_GEOMETRIES = 3;
+template <typename Geo>
+constexpr int geometry_slot() {
+    if constexpr (std::is_same_v<Geo, SmallBoard>) return 0;
+    else if constexpr (std::is_same_v<Geo, MediumBoard>) return 1;
+    else return 2;
+}
+
 // ---- Move struct  ----
-// This struct remains unchanged as it's part of the API
-// that pybind uses to return the move to Python.
+// This struct is part of the API that pybind uses to return the move to
+// Python. The search itself works on PackedMove and only builds one of these
+// for the move it finally returns.
 struct Move {
     std::string action;
     std::vector<int> from;
@@ -198,159 +421,322 @@ struct Move {
         : action(std::move(act)), from(std::move(f)), to(std::move(t)), pushed_to(std::move(pt)),
           orientation(orient.empty() ? std::nullopt : std::make_optional(std::move(orient))) {}
 };
+
+// ---- PackedMove (search-internal move) ----
+enum class ActionType : uint8_t { MOVE = 0, PUSH = 1, FLIP = 2, ROTATE = 3 };
+
+/**
+ * @brief A whole move in 32 bits, used everywhere inside the search.
+ *
+ * Layout: bits 0-8 from, 9-17 to, 18-26 pushed_to (cell indices),
+ * bits 27-28 action, bits 29-30 orientation (flip of a stone only), bit 31
+ * set on a MOVE that flows along rivers (its `to` may still be adjacent).
+ * A default-constructed PackedMove is the "no move" value.
+ */
+struct PackedMove {
+    uint32_t data {0};
+
+    PackedMove() = default;
+    PackedMove(ActionType action, int from, int to, int pushed_to = 0, Orientation orientation = Orientation::NONE, bool flow = false)
+        : data(static_cast<uint32_t>(from)
+               | (static_cast<uint32_t>(to) << 9)
+               | (static_cast<uint32_t>(pushed_to) << 18)
+               | (static_cast<uint32_t>(action) << 27)
+               | (static_cast<uint32_t>(orientation) << 29)
+               | (static_cast<uint32_t>(flow) << 31)) {}
+
+    inline int from() const { return data & 0x1FF; }
+    inline int to() const { return (data >> 9) & 0x1FF; }
+    inline int pushed_to() const { return (data >> 18) & 0x1FF; }
+    inline ActionType action() const { return static_cast<ActionType>((data >> 27) & 0x3); }
+    inline bool is_flow() const { return (data >> 31) != 0; }
+    inline Orientation orientation() const { return static_cast<Orientation>((data >> 29) & 0x3); }
+    inline bool is_null() const { return data == 0; }
+
+    inline bool operator==(const PackedMove& o) const { return data == o.data; }
+    inline bool operator!=(const PackedMove& o) const { return data != o.data; }
+
+    // Builds the pybind-facing Move. Called once per turn, for the returned move.
+    Move to_move() const {
+        const std::vector<int> from_pos {cell_x(from()), cell_y(from())};
+        switch (action()) {
+            case ActionType::MOVE:
+                return Move("move", from_pos, {cell_x(to()), cell_y(to())});
+            case ActionType::PUSH:
+                return Move("push", from_pos, {cell_x(to()), cell_y(to())}, {cell_x(pushed_to()), cell_y(pushed_to())});
+            case ActionType::FLIP:
+                if (orientation() == Orientation::NONE) return Move("flip", from_pos, from_pos);
+                return Move("flip", from_pos, from_pos, {}, (orientation() == Orientation::HORIZONTAL) ? "horizontal" : "vertical");
+            case ActionType::ROTATE:
+                return Move("rotate", from_pos, from_pos);
+        }
+        return Move();
+    }
+};
+// ---- RiverNetwork Class ----
+/**
+ * @brief Cached river flow graph for one board, kept in sync move by move.
+ *
+ * For every river and for each player (flow stops before that player's rival
+ * score cells, so the two differ) it stores the empty cells its two rays
+ * reach, the river each ray runs into (its flow edge) and the last cell each
+ * ray looks at. A move only invalidates the rivers whose rays cross one of the
+ * 1-3 cells it changed, so apply() recomputes just those and saves their old
+ * edges; revert() puts them back when the move is unmade.
+ *
+ * flow_destinations() answers the same question as
+ * MoveGenerator::explore_river_network by walking the cached edges. When the
+ * mover's own square stops one of the walked rays, the flow really passes
+ * through it, so only that ray is extended past the mover on the fly.
+ */
+template <typename Geo>
+class RiverNetwork {
+public:
+    void build(const FastBoard& board);
+    // Call right after make_move(move). Calls must be undone in LIFO order.
+    void apply(const FastBoard& board, PackedMove move);
+    // Call right after unmake_move of the most recently applied move.
+    void revert();
+    // `touched`, when given, gets every cell the answer was read from.
+    Bitboard flow_destinations(const FastBoard& board, int start_idx, int moving_idx, Player player, Bitboard* touched = nullptr) const;
+
+private:
+    struct RiverEdges {
+        Bitboard destinations;
+        std::array<int16_t, 2> successor {{-1, -1}}; // River the ray runs into, or -1
+        std::array<int16_t, 2> ray_end {{-1, -1}};   // Last cell the ray looked at, or -1
+    };
+
+    static constexpr const Bitboard& rival_area(int slot) { return Geo::rival_score_mask(slot == 0 ? Player::SQUARE : Player::CIRCLE); }
+    void compute_edges(const FastBoard& board, int idx);
+    static std::pair<int, int> ray_direction(const FastBoard& board, int idx, int d);
+
+    static constexpr std::array<Bitboard, MAX_ROWS> make_row_masks() {
+        std::array<Bitboard, MAX_ROWS> masks {};
+        for (int y = 0; y < MAX_ROWS; ++y) for (int x = 0; x < MAX_COLS; ++x) masks[y].set(cell_index(x, y));
+        return masks;
+    }
+    static constexpr std::array<Bitboard, MAX_COLS> make_col_masks() {
+        std::array<Bitboard, MAX_COLS> masks {};
+        for (int y = 0; y < MAX_ROWS; ++y) for (int x = 0; x < MAX_COLS; ++x) masks[x].set(cell_index(x, y));
+        return masks;
+    }
+    static constexpr auto ROW_MASK = make_row_masks();
+    static constexpr auto COL_MASK = make_col_masks();
+
+    Bitboard tracked;                     // Rivers whose edges are current
+    std::array<std::array<RiverEdges, MAX_CELLS>, 2> edges;
+    std::array<Bitboard, MAX_CELLS> ray_cells; // Every cell either player's rays look at
+
+    // Undo stack for apply()/revert()
+    struct SavedRiver {
+        int idx;
+        std::array<RiverEdges, 2> edges;
+        Bitboard ray_cells;
+    };
+    struct Frame {
+        size_t first_saved;
+        Bitboard tracked;
+    };
+    std::vector<SavedRiver> saved_rivers;
+    std::vector<Frame> frames;
+};
+
 // ---- MoveGenerator Class ----
+template <typename Geo>
 class MoveGenerator {
 public:
     // Main function to get all possible moves for a player using a fast, single-pass approach.
-    static std::vector<Move> calculate_possible_actions(const FastBoard& board, Player player, int rows, int cols, const std::vector<int>& score_cols) {
-        std::vector<Move> all_moves;
-        all_moves.reserve(150);
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                const auto& piece = board[y][x];
-                // Refactored
-                if (!piece.isEmpty() && piece.player == player) {
-                    get_actions_for_piece(board, x, y, player, rows, cols, score_cols, all_moves);
-                }
-            }
-        }
+    static std::vector<PackedMove> calculate_possible_actions(const FastBoard& board, Player player) {
+        std::vector<PackedMove> all_moves;
+        calculate_possible_actions(board, player, all_moves);
         return all_moves;
     }
+    // Same, but fills a caller-owned list so its capacity is reused across calls.
+    // With a RiverNetwork kept in sync with `board`, river flows are read from it.
+    static void calculate_possible_actions(const FastBoard& board, Player player, std::vector<PackedMove>& all_moves, const RiverNetwork<Geo>* network = nullptr) {
+        all_moves.clear();
+        all_moves.reserve(150);
+        board.pieces_of(player).for_each([&](int idx) {
+            get_actions_for_piece(board, cell_x(idx), cell_y(idx), player, all_moves, network);
+        });
+    }
     // Generates all possible actions for a single piece at a given coordinate.
-    static void get_actions_for_piece(const FastBoard& board, int x, int y, Player player, int rows, int cols, const std::vector<int>& score_cols, std::vector<Move>& moves_list) {
-        const auto& piece = board[y][x];
+    static void get_actions_for_piece(const FastBoard& board, int x, int y, Player player, std::vector<PackedMove>& moves_list, const RiverNetwork<Geo>* network = nullptr) {
+        get_transform_actions(board, x, y, player, moves_list);
+        get_displacement_actions(board, x, y, player, moves_list, network);
+    }
+
+    // Transformation moves (flip/rotate) of the piece at (x, y).
+    static void get_transform_actions(const FastBoard& board, int x, int y, Player player, std::vector<PackedMove>& moves_list) {
+        const Piece piece = board.at(x, y);
+        const int idx = cell_index(x, y);
         
-        // Transformation moves (flip/rotate)
         if (piece.side == Side::STONE) {
-            // Check horizontal flip
-            FastBoard temp_board_h = board;
-            temp_board_h[y][x].side = Side::RIVER;
-            temp_board_h[y][x].orientation = Orientation::HORIZONTAL;
+            // Check horizontal flip. The flow is evaluated as if (x, y) already
+            // held the river, without copying the board.
             // A flip's flow check treats the piece's own square as the "mover"
-            auto flow_h = explore_river_network(temp_board_h, x, y, x, y, player, rows, cols, score_cols, false);
-            bool safe_h = true;
-            for (const auto& dest : flow_h) {
-                if (rival_score_area(dest[0], dest[1], player, rows, cols, score_cols)) {
-                    safe_h = false;
-                    break;
-                }
-            }
-            if (safe_h) {
-                moves_list.emplace_back("flip", std::vector<int>{x, y}, std::vector<int>{x, y}, std::vector<int>{}, "horizontal");
+            auto flow_h = explore_river_network(board, x, y, x, y, player, false, idx, stone_code(player) + 1);
+            if (!reaches_rival_score_area(flow_h, player)) {
+                moves_list.emplace_back(ActionType::FLIP, idx, idx, 0, Orientation::HORIZONTAL);
             }
 
             // Check vertical flip
-            FastBoard temp_board_v = board;
-            temp_board_v[y][x].side = Side::RIVER;
-            temp_board_v[y][x].orientation = Orientation::VERTICAL;
-            auto flow_v = explore_river_network(temp_board_v, x, y, x, y, player, rows, cols, score_cols, false);
-            bool safe_v = true;
-            for (const auto& dest : flow_v) {
-                if (rival_score_area(dest[0], dest[1], player, rows, cols, score_cols)) {
-                    safe_v = false;
-                    break;
-                }
-            }
-            if (safe_v) {
-                moves_list.emplace_back("flip", std::vector<int>{x, y}, std::vector<int>{x, y}, std::vector<int>{}, "vertical");
+            auto flow_v = explore_river_network(board, x, y, x, y, player, false, idx, stone_code(player) + 2);
+            if (!reaches_rival_score_area(flow_v, player)) {
+                moves_list.emplace_back(ActionType::FLIP, idx, idx, 0, Orientation::VERTICAL);
             }
 
         } else { // River
             // Flip river->stone is always valid
-            moves_list.emplace_back("flip", std::vector<int>{x, y}, std::vector<int>{x, y});
-
-            Orientation new_orientation = (piece.orientation == Orientation::HORIZONTAL) ? Orientation::VERTICAL : Orientation::HORIZONTAL;
-            FastBoard temp_board_r = board;
-            temp_board_r[y][x].orientation = new_orientation;
-            auto flow_r = explore_river_network(temp_board_r, x, y, x, y, player, rows, cols, score_cols, false);
-            bool safe_r = true;
-            for (const auto& dest : flow_r) {
-                if (rival_score_area(dest[0], dest[1], player, rows, cols, score_cols)) {
-                    safe_r = false;
-                    break;
-                }
-            }
-            if (safe_r) {
-                moves_list.emplace_back("rotate", std::vector<int>{x, y}, std::vector<int>{x, y});
+            moves_list.emplace_back(ActionType::FLIP, idx, idx);
+
+            const uint8_t rotated_code = (piece.orientation == Orientation::HORIZONTAL) ? stone_code(player) + 2 : stone_code(player) + 1;
+            auto flow_r = explore_river_network(board, x, y, x, y, player, false, idx, rotated_code);
+            if (!reaches_rival_score_area(flow_r, player)) {
+                moves_list.emplace_back(ActionType::ROTATE, idx, idx);
             }
             
         }
+    }
+
+    // Whether get_transform_actions generates `move` (a flip or rotate) for `player`.
+    static bool is_legal_transform(const FastBoard& board, PackedMove move, Player player) {
+        const int idx = move.from();
+        const Piece piece = board.at(idx);
+        if (piece.player != player) return false;
+        const int x = cell_x(idx), y = cell_y(idx);
+        if (piece.side == Side::STONE) {
+            for (Orientation orientation : {Orientation::HORIZONTAL, Orientation::VERTICAL}) {
+                if (move != PackedMove(ActionType::FLIP, idx, idx, 0, orientation)) continue;
+                const uint8_t river_code = stone_code(player) + (orientation == Orientation::HORIZONTAL ? 1 : 2);
+                return !reaches_rival_score_area(explore_river_network(board, x, y, x, y, player, false, idx, river_code), player);
+            }
+            return false;
+        }
+        if (move == PackedMove(ActionType::FLIP, idx, idx)) return true;
+        if (move != PackedMove(ActionType::ROTATE, idx, idx)) return false;
+        const uint8_t rotated_code = (piece.orientation == Orientation::HORIZONTAL) ? stone_code(player) + 2 : stone_code(player) + 1;
+        return !reaches_rival_score_area(explore_river_network(board, x, y, x, y, player, false, idx, rotated_code), player);
+    }
+
+    // Moves the quiescence search follows: a stone entering our score cells, a
+    // push onto or off any score cells, a stone's river flow ending next to
+    // our score cells (a goal entry on the next move), or a flip of our river
+    // standing on our score cells, which leaves a stone there. `move` is a
+    // move of `player` on `board`, not yet made.
+    static bool is_tactical(const FastBoard& board, PackedMove move, Player player) {
+        if (move.action() == ActionType::ROTATE) return false;
+        if (move.action() == ActionType::FLIP) {
+            return board.at(move.from()).side == Side::RIVER && Geo::is_own_score_cell(move.from(), player);
+        }
+        if (move.action() == ActionType::PUSH) {
+            return Geo::SCORE_MASKS.test(move.to()) || Geo::SCORE_MASKS.test(move.pushed_to());
+        }
+        if (board.at(move.from()).side != Side::STONE) return false;
+        if (Geo::is_own_score_cell(move.to(), player)) return true;
+        return move.is_flow() && Geo::own_score_zone(player).test(move.to());
+    }
 
-        // Displacement moves (move/push)
+    // Displacement moves (move/push) of the piece at (x, y).
+    static void get_displacement_actions(const FastBoard& board, int x, int y, Player player, std::vector<PackedMove>& moves_list, const RiverNetwork<Geo>* network = nullptr) {
+        const Piece piece = board.at(x, y);
+        const int idx = cell_index(x, y);
+        Bitboard reached; // A cell reachable several ways is still one move, as in the engine
         constexpr std::array<std::pair<int, int>, 4> DIRECTIONS = {{{0, 1}, {0, -1}, {1, 0}, {-1, 0}}};
         for (const auto& [dx, dy] : DIRECTIONS) {
             int next_x = x + dx;
             int next_y = y + dy;
 
             // cannot move directly into an opponent's score cell
-            if (!within_board_limits(next_x, next_y, rows, cols) || rival_score_area(next_x, next_y, player, rows, cols, score_cols)) continue;
+            if (!Geo::in_bounds(next_x, next_y) || Geo::is_rival_score_cell(cell_index(next_x, next_y), player)) continue;
 
-            const auto& target_cell = board[next_y][next_x];
+            const Piece target_cell = board.at(next_x, next_y);
             
             if (target_cell.isEmpty()) {
-                moves_list.emplace_back("move", std::vector<int>{x, y}, std::vector<int>{next_x, next_y});
+                if (!reached.test(cell_index(next_x, next_y))) {
+                    moves_list.emplace_back(ActionType::MOVE, idx, cell_index(next_x, next_y));
+                    reached.set(cell_index(next_x, next_y));
+                }
             
             } else if (target_cell.side == Side::RIVER) {
                 // Call with river_push=false
-                auto flow_dests = explore_river_network(board, next_x, next_y, x, y, player, rows, cols, score_cols, false);
-                for (const auto& dest : flow_dests) {
-                    moves_list.emplace_back("move", std::vector<int>{x, y}, dest);
-                }
+                auto flow_dests = network ? network->flow_destinations(board, cell_index(next_x, next_y), idx, player)
+                                          : explore_river_network(board, next_x, next_y, x, y, player, false);
+                flow_dests.without(reached).for_each([&](int dest) {
+                    moves_list.emplace_back(ActionType::MOVE, idx, dest, 0, Orientation::NONE, true);
+                });
+                reached |= flow_dests;
             
             } else if (target_cell.side == Side::STONE) { // Pushing a stone
                 if (piece.side == Side::STONE) { // Stone-on-Stone push
                     int push_dest_x = next_x + dx;
                     int push_dest_y = next_y + dy;
                     Player target_owner = target_cell.player;
-                    // check destination against the pushed piece's (target_owner) opponent's score area
-                    if (within_board_limits(push_dest_x, push_dest_y, rows, cols) && 
-                        board[push_dest_y][push_dest_x].isEmpty() &&
-                        !rival_score_area(push_dest_x, push_dest_y, target_owner, rows, cols, score_cols)) {
-                        moves_list.emplace_back("push", std::vector<int>{x, y}, std::vector<int>{next_x, next_y}, std::vector<int>{push_dest_x, push_dest_y});
+                    // The engine checks the destination against both the mover's and
+                    // the pushed piece's (target_owner) opponent's score area
+                    if (Geo::in_bounds(push_dest_x, push_dest_y) && 
+                        board.is_empty(cell_index(push_dest_x, push_dest_y)) &&
+                        !Geo::is_rival_score_cell(cell_index(push_dest_x, push_dest_y), player) &&
+                        !Geo::is_rival_score_cell(cell_index(push_dest_x, push_dest_y), target_owner)) {
+                        moves_list.emplace_back(ActionType::PUSH, idx, cell_index(next_x, next_y), cell_index(push_dest_x, push_dest_y));
                     }
                 } else { // River-on-Stone push
                     
-                    auto push_dests = calculate_river_push_paths(board, x, y, next_x, next_y, target_cell.player, rows, cols, score_cols);
-                    for (const auto& dest : push_dests) {
-                        moves_list.emplace_back("push", std::vector<int>{x, y}, std::vector<int>{next_x, next_y}, dest);
-                    }
+                    auto push_dests = calculate_river_push_paths(board, x, y, next_x, next_y, target_cell.player);
+                    push_dests.for_each([&](int dest) {
+                        moves_list.emplace_back(ActionType::PUSH, idx, cell_index(next_x, next_y), dest);
+                    });
                     
                 }
             }
         }
     }
 
+    // True if any flow destination lands in the rival's score area.
+    static bool reaches_rival_score_area(const Bitboard& destinations, Player player) {
+        return (destinations & Geo::rival_score_mask(player)).any();
+    }
 
-    static std::vector<std::vector<int>> explore_river_network(
+    /**
+     * @brief Breadth-first flow over connected rivers.
+     *
+     * @param override_idx Optional cell read as `override_code` instead of its
+     *        real contents, so "what if this piece were flipped/rotated" needs no board copy.
+     * @return The set of empty cells a piece entering at (start_rx, start_ry) can land on.
+     */
+    static Bitboard explore_river_network(
         const FastBoard& board, 
         int start_rx, int start_ry, 
         int moving_sx, int moving_sy, 
         Player player, 
-        int rows, int cols, 
-        const std::vector<int>& score_cols,
-        bool river_push = false 
+        bool river_push = false,
+        int override_idx = -1,
+        uint8_t override_code = EMPTY
     ) {
-        std::vector<std::vector<int>> result;
-        result.reserve(32); 
-        std::vector<bool> visited_river(rows * cols, false);
-        std::vector<bool> visited_dest(rows * cols, false);
-        std::queue<std::pair<int, int>> to_visit;
+        auto code_at = [&](int idx) { return (idx == override_idx) ? override_code : board.code_at(idx); };
+        Bitboard result;
+        Bitboard visited_river;
+        std::array<uint16_t, MAX_CELLS> to_visit;
+        int head = 0, tail = 0;
         
-        to_visit.push({start_rx, start_ry});
-        visited_river[start_ry * cols + start_rx] = true;
-
-        while (!to_visit.empty()) {
-            auto [x, y] = to_visit.front();
-            to_visit.pop();
+        const int start_idx = cell_index(start_rx, start_ry);
+        const int moving_idx = cell_index(moving_sx, moving_sy);
+        to_visit[tail++] = start_idx;
+        visited_river.set(start_idx);
+
+        while (head < tail) {
+            const int idx = to_visit[head++];
+            const int x = cell_x(idx), y = cell_y(idx);
             
             
             // Get the piece that dictates flow direction
-            Piece cell = board[y][x]; 
-            if (river_push && x == start_rx && y == start_ry) {
+            Piece cell = piece_from_code(code_at(idx)); 
+            if (river_push && idx == start_idx) {
                 // This is a river-on-stone push. The "river" we start on is
                 // actually the stone, but it flows as if it were the PUSHER.
                 // The pusher is at (moving_sx, moving_sy).
-                cell = board[moving_sy][moving_sx];
+                cell = piece_from_code(code_at(moving_idx));
             }
             
 
@@ -362,29 +748,26 @@ public:
             for (const auto& [dx, dy] : directions) {
                 int nx = x + dx;
                 int ny = y + dy;
-                while (within_board_limits(nx, ny, rows, cols)) {
+                while (Geo::in_bounds(nx, ny)) {
+                    const int flat_idx = cell_index(nx, ny);
                     // Stop flow if it hits an opponent's score cell
-                    if (rival_score_area(nx, ny, player, rows, cols, score_cols)) break;
+                    if (Geo::is_rival_score_cell(flat_idx, player)) break;
                     
                     // Allow flow through the mover's original square
-                    if (nx == moving_sx && ny == moving_sy) {
+                    if (flat_idx == moving_idx) {
                         nx += dx; ny += dy; continue;
                     }
                     
-                    const auto& next_cell = board[ny][nx];
-                    const int flat_idx = ny * cols + nx;
+                    const uint8_t next_code = code_at(flat_idx);
                     
-                    if (next_cell.isEmpty()) {
+                    if (next_code == EMPTY) {
                         // This is a valid destination.
-                        if (!visited_dest[flat_idx]) {
-                            result.push_back({nx, ny});
-                            visited_dest[flat_idx] = true;
-                        }
-                    } else if (next_cell.side == Side::RIVER) {
+                        result.set(flat_idx);
+                    } else if (piece_from_code(next_code).side == Side::RIVER) {
                         // Found another river, add to queue and stop this path
-                        if (!visited_river[flat_idx]) {
-                            to_visit.push({nx, ny});
-                            visited_river[flat_idx] = true;
+                        if (!visited_river.test(flat_idx)) {
+                            to_visit[tail++] = flat_idx;
+                            visited_river.set(flat_idx);
                         }
                         break; 
                     } else { // Stone
@@ -408,13 +791,11 @@ public:
      * @param stone_y Pushed piece's Y (the stone piece).
      * @param stone_owner The owner of the pushed stone.
      */
-    static std::vector<std::vector<int>> calculate_river_push_paths(
+    static Bitboard calculate_river_push_paths(
         const FastBoard& board, 
         int river_x, int river_y, 
         int stone_x, int stone_y, 
-        Player stone_owner, 
-        int rows, int cols, 
-        const std::vector<int>& score_cols
+        Player stone_owner
     ) {
         
         // This calls explore_river_network, which handles the
@@ -428,7 +809,6 @@ public:
             stone_x, stone_y,  // Start flow from the stone's position
             river_x, river_y,  // Pass the pusher's position
             stone_owner,       // Check scoring for the stone's owner
-            rows, cols, score_cols, 
             true               // Set river_push flag to true
         );
         
@@ -436,526 +816,1851 @@ public:
 };
 
 
-static std::map<int, int> distancePowerMap = {
-    {0, 1},    
-    {1, 3},    
-    {2, 8},    
-    {3, 20},   
-    {4, 50},   
-    {5, 250},  
-    {6, 500},  
-    {7, 1000},
-    {8, 2000},
-    {9, 4000},
-    {10, 8000},
-    {11, 10000},
-    {12, 16000},
-};
-
-// Evaluates the offensive strength based on proximity to the scoring area.
-class AttackManager {
+// ---- MoveOrdering Class ----
+/**
+ * @brief Move-ordering knowledge learned from beta cutoffs, so a node can
+ * order its moves without evaluating every child.
+ *
+ * - Killers: per ply, the last two moves that cut off there. A move that
+ *   refutes one line often refutes its siblings too.
+ * - History: per side, action, from cell and to cell, a depth²-weighted
+ *   count of cutoffs, pulled back towards 0 as it grows (HISTORY_MAX).
+ * - Countermoves: per side, the move that last refuted each opponent move,
+ *   by that move's from and to cells.
+ *
+ * Every search thread has its own tables. new_search() keeps the history and
+ * countermoves (halving the history) but clears the killers, whose plies
+ * meant other positions last turn.
+ */
+class MoveOrdering {
 public:
-    // --- AttackManager ---
-    int evaluate_top_pieces_proximity(const FastBoard& board, Player player, int rows, int cols, const std::vector<int>& score_cols, double friendly_weight, double opponent_weight) const {
-            double friendly_score = 0;
-            double opponent_score = 0;
-
-            // Weights for "Gravity"
-            const int SCORE_STONE_IN_GOAL = 50000; // Massive reward -> locks piece in place
-            const int SCORE_RIVER_IN_GOAL = 20000; // High reward -> incentivizes entering goal
-            const int SCORE_DIST_1        = 2000;  // Doorstep
-            const int SCORE_DIST_2        = 1000;   // Approach
-            const int SCORE_DIST_3        = 500;   // Setup
-            
-            for (int y = 0; y < rows; ++y) {
-                for (int x = 0; x < cols; ++x) {
-                    const auto& cell = board[y][x];
-                    if (cell.isEmpty()) continue;
-
-                    const Player piece_owner = cell.player;
-                    // Calculate true distance 
-                    int dist = distance_to_own_scoring_area(x, y, piece_owner, rows, cols, score_cols);
-                    
-                    int score_contribution = 0;
-
-                    if (dist == 0) {
-                        // It is INSIDE the score area
-                        if (cell.side == Side::STONE) {
-                            score_contribution = SCORE_STONE_IN_GOAL;
-                        } else {
-                            // It's a River in the goal. High value, but Stone is better.
-                            // This difference (50k vs 15k) forces the bot to FLIP to stone.
-                            score_contribution = SCORE_RIVER_IN_GOAL;
-                        }
-                    } 
-                    else if (dist == 1) score_contribution = SCORE_DIST_1;
-                    else if (dist == 2) score_contribution = SCORE_DIST_2;
-                    else if (dist == 3) score_contribution = SCORE_DIST_3;
-                    else if (dist < 8)  score_contribution = (10 - dist) * 10; // Minimal trail
-
-                    // Accumulate
-                    if (piece_owner == player) {
-                        friendly_score += score_contribution;
-                    } else {
-                        // We want to calculate opponent threat using the same logic.
-                        // If opponent has a stone in goal, that's bad for us.
-                        opponent_score += score_contribution;
-                    }
-                }
-            }
+    static constexpr int MAX_PLY = 64;
+    static constexpr int HISTORY_MAX = 16384;
 
-            return static_cast<int>(friendly_weight * friendly_score + opponent_weight * opponent_score);
-        }
-};
+    MoveOrdering() : history(2 * 4 * MAX_CELLS * MAX_CELLS), countermoves(2 * MAX_CELLS * MAX_CELLS) {}
 
-// Evaluates the board from a defensive perspective.
-class DefenseManager {
-public:
-    // --- DefenseManager ---
-    int penalty_for_blocked_score_zone(const FastBoard& board, Player player, int rows, int cols, const std::vector<int>& score_cols) const {
-        int penalty = 0;
-        auto my_scoring_cells = own_scoring_areas(player, rows, cols, score_cols);
+    void new_search() {
+        for (auto& ply_killers : killers) ply_killers = {};
+        for (int16_t& value : history) value /= 2;
+    }
 
-        for (const auto& cell_coords : my_scoring_cells) {
-            const auto& cell = board[cell_coords.second][cell_coords.first];
-            
-            if (!cell.isEmpty() && cell.player == player && cell.side == Side::RIVER) {
-                penalty -= 10000;
-            }
+    // `previous` is the opponent's move into this node (null at the root).
+    void record_cutoff(Player player, int ply, int depth, PackedMove move, PackedMove previous) {
+        assert(ply < MAX_PLY);
+        if (killers[ply][0] != move) {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = move;
         }
-        return penalty;
+        int16_t& value = history[history_index(player, move)];
+        const int bonus = std::min(depth * depth, HISTORY_MAX);
+        value = static_cast<int16_t>(value + bonus - value * bonus / HISTORY_MAX);
+        if (!previous.is_null()) countermoves[countermove_index(opponent(player), previous)] = move;
     }
+
+    const std::array<PackedMove, 2>& killers_at(int ply) const { return killers[ply]; }
+    bool is_killer(int ply, PackedMove move) const { return killers[ply][0] == move || killers[ply][1] == move; }
+    int history_score(Player player, PackedMove move) const { return history[history_index(player, move)]; }
+    PackedMove countermove(Player player, PackedMove previous) const {
+        return previous.is_null() ? PackedMove() : countermoves[countermove_index(opponent(player), previous)];
+    }
+
+private:
+    static size_t history_index(Player player, PackedMove move) {
+        return ((static_cast<size_t>(player_slot(player)) * 4 + static_cast<size_t>(move.action())) * MAX_CELLS + move.from()) * MAX_CELLS + move.to();
+    }
+    // Indexed by the side that played `previous`
+    static size_t countermove_index(Player player, PackedMove previous) {
+        return (static_cast<size_t>(player_slot(player)) * MAX_CELLS + previous.from()) * MAX_CELLS + previous.to();
+    }
+
+    std::array<std::array<PackedMove, 2>, MAX_PLY> killers {};
+    std::vector<int16_t> history;
+    std::vector<PackedMove> countermoves;
 };
 
-// Evaluates the strategic value of river networks.
-class RiverNetworkManager {
+// ---- StagedMoveGenerator Class ----
+/**
+ * @brief Hands out one side's moves a phase at a time, likely-best first.
+ *
+ * Phases: the hash move, moves landing on our own score row, the killer
+ * moves and the countermove (with MoveOrdering tables), the other
+ * river-flow, push and one-step moves, then flips/rotates. With tables,
+ * the last two phases are sorted by history; ties keep flow and push moves
+ * before single steps. Displacement moves are generated together when the
+ * hash move is used up; flips/rotates, whose safety checks each walk the
+ * river network, only when everything before them has been searched. A node
+ * that cuts off early never generates the rest.
+ *
+ * The board (and network) must be back in the node's position whenever
+ * next() is called, which make/unmake around each child guarantees.
+ */
+template <typename Geo>
+class StagedMoveGenerator {
 public:
-    // --- RiverNetworkManager ---
-    int evaluate_river_system_potential(const FastBoard& board, Player player, int rows, int cols, const std::vector<int>& score_cols, double friendly_weight, double opponent_weight) const {
-        int friendly_score_component = 0;
-        int opponent_score_component = 0;
-        const Player opponent_player = opponent(player); 
+    // `buffer` holds the current phase's moves; the caller owns it so its capacity can be reused.
+    // `ordering` supplies the killers of `ply`, the countermove to `previous` and the history.
+    StagedMoveGenerator(const FastBoard& board, Player player, PackedMove hash_move, std::vector<PackedMove>& buffer, const RiverNetwork<Geo>* network = nullptr,
+                        const MoveOrdering* ordering = nullptr, int ply = 0, PackedMove previous = PackedMove())
+        : board(board), player(player), network(network), buffer(buffer), ordering(ordering), special{hash_move} {
+        if (ordering) {
+            special[1] = ordering->killers_at(ply)[0];
+            special[2] = ordering->killers_at(ply)[1];
+            special[3] = ordering->countermove(player, previous);
+        }
+    }
 
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                const auto& cell = board[y][x];
-                
-                if (cell.isEmpty() || cell.side != Side::RIVER) continue;
-
-                int friendly_stones_near = 0;
-                int opponent_stones_near = 0;
-                std::pair<int, int> friendly_stone_pos = {-1, -1};
-                std::pair<int, int> opponent_stone_pos = {-1, -1};
-                
-                for (const auto& [dx, dy] : {std::pair{1,0}, {-1,0}, {0,1}, {0,-1}}) {
-                    const int adj_x = x + dx;
-                    const int adj_y = y + dy;
-                    
-                    if (!within_board_limits(adj_x, adj_y, rows, cols)) continue;
-                    if (is_player_scoring_slot(x, y, player, rows, cols, score_cols) || rival_score_area(x, y, player, rows, cols, score_cols)) continue;
-                    
-                    const auto& adj_cell = board[adj_y][adj_x];
-                    if (adj_cell.isEmpty() || is_player_scoring_slot(adj_x, adj_y, player, rows, cols, score_cols) || rival_score_area(adj_x, adj_y, player, rows, cols, score_cols)) continue;
-                    
-                    if (adj_cell.player == player) {
-                        friendly_stones_near++;
-                        if (friendly_stone_pos.first == -1) friendly_stone_pos = {adj_x, adj_y};
-                    } else {
-                        opponent_stones_near++;
-                        if (opponent_stone_pos.first == -1) opponent_stone_pos = {adj_x, adj_y};
+    // Returns the next move, or a null PackedMove once every phase is used up.
+    PackedMove next() {
+        while (true) {
+            switch (stage) {
+                case Stage::HASH:
+                    stage = Stage::GENERATE_DISPLACEMENTS;
+                    if (!special[0].is_null() && is_pseudo_legal(special[0])) return special[0];
+                    special[0] = PackedMove(); // Nothing to skip later
+                    break;
+                case Stage::GENERATE_DISPLACEMENTS:
+                    generate_displacements();
+                    stage = Stage::SCORING;
+                    break;
+                case Stage::SCORING:
+                    while (cursor < scoring_end) {
+                        const PackedMove move = buffer[cursor++];
+                        if (move != special[0]) return move;
                     }
-                }
-                
-                int max_river_distance = 4; // Default for small
-                if (rows >= 17) {
-                    max_river_distance = 10; //  for large
-                } else if (rows >= 15) {
-                    max_river_distance = 8; //  for medium
-                }
-                if (friendly_stones_near > 0) {
-                    
-                    //  MoveGenerator::explore_river_network for consistency.
-                    const auto destinations = MoveGenerator::explore_river_network(board, x, y, friendly_stone_pos.first, friendly_stone_pos.second, player, rows, cols, score_cols, false);
-                    
-                    int best_potential_score = 0;
-                    for (const auto& dest : destinations) {
-                        const int distance = std::clamp(distance_to_own_scoring_area(dest[0], dest[1], player, rows, cols, score_cols), 0, max_river_distance);
-                        best_potential_score = std::max(best_potential_score, max_river_distance - distance);
+                    stage = Stage::REFUTATIONS;
+                    break;
+                case Stage::REFUTATIONS:
+                    // Killers and countermove, each only if this position has it.
+                    if (special_index == special.size()) {
+                        sort_by_history(buffer.begin() + scoring_end, buffer.end());
+                        stage = Stage::QUIETS;
+                        break;
                     }
-                    friendly_score_component += best_potential_score * friendly_stones_near;
-                }
-                
-                if (opponent_stones_near > 0) {
-                    
-                    // MoveGenerator::explore_river_network for consistency.
-                    const auto opp_destinations = MoveGenerator::explore_river_network(board, x, y, opponent_stone_pos.first, opponent_stone_pos.second, opponent_player, rows, cols, score_cols, false);
-                    
-                    int best_opp_potential_score = 0;
-                    for (const auto& dest : opp_destinations) {
-                        const int distance = std::clamp(distance_to_own_scoring_area(dest[0], dest[1], opponent_player, rows, cols, score_cols), 0, max_river_distance);
-                        best_opp_potential_score = std::max(best_opp_potential_score, max_river_distance - distance);
+                    if (PackedMove& move = special[special_index++]; !move.is_null()) {
+                        if (is_new_refutation(special_index - 1) && is_legal_refutation(move)) return move;
+                        move = PackedMove(); // Nothing to skip later
                     }
-                    opponent_score_component += best_opp_potential_score * opponent_stones_near;
-                }
+                    break;
+                case Stage::QUIETS:
+                    if (PackedMove move = pop_from_buffer(); !move.is_null()) return move;
+                    generate_transforms();
+                    stage = Stage::TRANSFORMS;
+                    break;
+                case Stage::TRANSFORMS:
+                    if (PackedMove move = pop_from_buffer(); !move.is_null()) return move;
+                    stage = Stage::DONE;
+                    break;
+                case Stage::DONE:
+                    return PackedMove();
             }
         }
-        return static_cast<int>(friendly_weight * friendly_score_component + opponent_weight * opponent_score_component);
     }
+
 private:
+    enum class Stage : uint8_t { HASH, GENERATE_DISPLACEMENTS, SCORING, REFUTATIONS, QUIETS, TRANSFORMS, DONE };
 
-    std::vector<std::vector<int>> try_river_flow_path(const FastBoard& board,
-        int start_x, int start_y,
-        int prev_x, int prev_y,
-        Player player,
-        int rows, int cols,
-        const std::vector<int>& scoring_cols) const {
-        std::vector<std::vector<int>> reachable;
-        reachable.reserve(rows * cols / 4);  // pre-allocate some space to reduce reallocs
-        std::vector<bool> visited(rows * cols, false);
-        constexpr std::array<std::pair<int,int>,4> directions = {{
-            {1,0}, {-1,0}, {0,1}, {0,-1}
-        }};
-        std::queue<std::pair<int,int>> frontier;
-        frontier.emplace(start_x, start_y);
-        visited[start_y * cols + start_x] = true; // Use 1D indexing
-        while (!frontier.empty()) {
-            auto [cx, cy] = frontier.front();
-            frontier.pop();
-            for (auto [dx, dy] : directions) {
-                int nx = cx + dx;
-                int ny = cy + dy;
-                if (!within_board_limits(nx, ny, rows, cols)) continue;
-                const int flat_idx = ny * cols + nx;
-                if (visited[flat_idx]) continue;
-                const auto& cell = board[ny][nx];
-                if (cell.isEmpty()) {
-                    if (!rival_score_area(nx, ny, player, rows, cols, scoring_cols)) {
-                        reachable.push_back({nx, ny});
-                    }
-                } else if (cell.side != Side::STONE) { // i.e., is a River
-                    frontier.emplace(nx, ny);
-                    visited[flat_idx] = true; // Use 1D indexing
-                }
-            }
-        }
-        return reachable;
+    // Scoring moves, then other flow/push moves, then one-step moves, each in generation order.
+    void generate_displacements() {
+        buffer.clear();
+        board.pieces_of(player).for_each([&](int idx) {
+            MoveGenerator<Geo>::get_displacement_actions(board, cell_x(idx), cell_y(idx), player, buffer, network);
+        });
+        const Bitboard& own_score = Geo::own_score_mask(player);
+        auto scoring = std::stable_partition(buffer.begin(), buffer.end(), [&](PackedMove move) {
+            return own_score.test(move.to());
+        });
+        std::stable_partition(scoring, buffer.end(), [](PackedMove move) {
+            return move.action() == ActionType::PUSH || move.is_flow();
+        });
+        scoring_end = static_cast<size_t>(scoring - buffer.begin());
+        cursor = 0;
     }
-};
-
-// ---- Main TacticalEvaluator Class ----
-class TacticalEvaluator {
-public:
-    TacticalEvaluator(double friendly_weight, double opponent_weight) 
-        : friendly_component_weight(friendly_weight), opponent_component_weight(opponent_weight) {
-        
-        attack_manager = std::make_unique<AttackManager>();
-        defense_manager = std::make_unique<DefenseManager>();
-        river_manager = std::make_unique<RiverNetworkManager>();
 
-        
-        // This lambda now includes the scattering score
-        heuristic_methods["Final_Evaluation"] = [this](const FastBoard& board, Player player, int rows, int cols, const std::vector<int>& score_cols) {
-
-        // Dynamic weights based on board size
-        double attack_weight = 2.0;
-        double river_weight = 2.0;
-        double defense_weight = 3.2;
-
-        // Default friendly/opponent multipliers (constructor defaults)
-        double local_friendly = friendly_component_weight;
-        double local_opponent = opponent_component_weight;
-
-        // --- LARGE (aggressive) ---
-        if (rows >= 17) { // large 17x16
-            // Aggressive large-board tuning (mobility + highways prioritized)
-            attack_weight = 6.0;
-            river_weight  = 10.0;
-            defense_weight = 2.0;
-            // local_friendly = 2.0;
-            // local_opponent = -2.1;
-        }
-        // --- MEDIUM (aggressive) ---
-        else if (rows >= 15) { // medium 15x14
-            // Aggressive medium-board tuning (balanced attack + river)
-            attack_weight = 2.0;
-            river_weight  = 3.0;
-            defense_weight = 2.0;
-
-            local_friendly = 1.0;
-            local_opponent = -2.40;
-        }
-        // --- SMALL ---
-        else{
-            local_friendly = 1.2;
-            local_opponent = -2.60;
-        }
-        // Small board: keep default weights (unchanged)
-        
-        // Compute all scores
-        int attack_score = attack_manager->evaluate_top_pieces_proximity(board, player, rows, cols, score_cols, local_friendly, local_opponent);
-        int river_score = river_manager -> evaluate_river_system_potential(board, player, rows, cols, score_cols, local_friendly, local_opponent);
-        int defense_penalty = defense_manager->penalty_for_blocked_score_zone(board, player, rows, cols, score_cols);
-        int near_win_bonus = calculate_near_win_bonus(board, player, rows, cols, score_cols);
-        int highway_potential_score = evaluate_river_highway_potential(board, player, rows, cols, score_cols);
-
-
-        // Combine all scores
-        return (
-                    (attack_weight * attack_score)
-                    + (river_weight  * river_score)
-                    + (defense_weight * defense_penalty) // defense_weight is 1.0, 2.0, etc.
-                    + highway_potential_score
-                    + 0.9 * near_win_bonus
-                );
-        };
-        
+    void generate_transforms() {
+        buffer.clear();
+        board.pieces_of(player).for_each([&](int idx) {
+            MoveGenerator<Geo>::get_transform_actions(board, cell_x(idx), cell_y(idx), player, buffer);
+        });
+        sort_by_history(buffer.begin(), buffer.end());
+        cursor = 0;
     }
-    int evaluate_river_highway_potential(const FastBoard& board, Player player, int rows, int cols, const std::vector<int>& score_cols) const {
-        int highway_score = 0;
-        int max_dist = (rows >= 17) ? 10 : ((rows >= 15) ? 8 : 6);
-
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                const auto& cell = board[y][x];
 
-                // Only score *my own* rivers
-                if (cell.isEmpty() || cell.player != player || cell.side != Side::RIVER) continue;
+    void sort_by_history(std::vector<PackedMove>::iterator first, std::vector<PackedMove>::iterator last) {
+        if (!ordering) return;
+        std::stable_sort(first, last, [&](PackedMove a, PackedMove b) {
+            return ordering->history_score(player, a) > ordering->history_score(player, b);
+        });
+    }
 
-                // Use the MoveGenerator's explore_river_network function
-                // We pass (x,y) as both the start and the "mover"
-                auto destinations = MoveGenerator::explore_river_network(board, x, y, x, y, player, rows, cols, score_cols, false);
+    PackedMove pop_from_buffer() {
+        while (cursor < buffer.size()) {
+            const PackedMove move = buffer[cursor++];
+            if (std::find(special.begin(), special.end(), move) == special.end()) return move; // Else already handed out
+        }
+        return PackedMove();
+    }
 
-                if (destinations.empty()) continue;
+    // The hash move comes from a table entry for this position, but check that
+    // this piece really generates it before handing it out ungenerated.
+    bool is_pseudo_legal(PackedMove move) {
+        const int from = move.from();
+        if (board.at(from).player != player) return false;
+        buffer.clear();
+        if (move.action() == ActionType::FLIP || move.action() == ActionType::ROTATE) {
+            MoveGenerator<Geo>::get_transform_actions(board, cell_x(from), cell_y(from), player, buffer);
+        } else {
+            MoveGenerator<Geo>::get_displacement_actions(board, cell_x(from), cell_y(from), player, buffer, network);
+        }
+        return std::find(buffer.begin(), buffer.end(), move) != buffer.end();
+    }
 
-                int best_dist = 99; // Find the closest-to-goal empty square this river can reach
-                for (const auto& dest : destinations) {
-                    best_dist = std::min(best_dist, distance_to_own_scoring_area(dest[0], dest[1], player, rows, cols, score_cols));
-                }
+    bool is_new_refutation(size_t index) const {
+        return std::find(special.begin(), special.begin() + index, special[index]) == special.begin() + index;
+    }
 
-                if (best_dist != 99) {
-                    // This river has "potential." Score it.
-                    int score_contribution = max_dist - best_dist;
-                    // We use distancePowerMap to make it aggressive.
-                    if (distancePowerMap.count(score_contribution)) {
-                        // We divide by 2 to make it less valuable than a piece *already*
-                        // on that square, but still valuable enough to build.
-                        highway_score += distancePowerMap.at(score_contribution) / 2;
-                    }
-                }
-            }
+    // Killers and countermoves come from other positions. Displacements are
+    // looked up among the generated ones not handed out yet (scoring moves
+    // already were); transforms are checked directly, as none are generated yet.
+    bool is_legal_refutation(PackedMove move) const {
+        if (move.action() == ActionType::FLIP || move.action() == ActionType::ROTATE) {
+            return MoveGenerator<Geo>::is_legal_transform(board, move, player);
         }
-        return highway_score;
+        return std::find(buffer.begin() + scoring_end, buffer.end(), move) != buffer.end();
     }
 
-    int calculate_near_win_bonus(const FastBoard& board, Player player, 
-                                int rows, int cols, 
-                                const std::vector<int>& score_cols) const {
-        // Get scoring area cells
-        auto my_scoring_cells = own_scoring_areas(player, rows, cols, score_cols);
-        
-        // Count pieces in goal and find empty cell
-        int pieces_in_goal = 0;
-        std::pair<int, int> empty_goal_cell = {-1, -1};
+    const FastBoard& board;
+    Player player;
+    const RiverNetwork<Geo>* network;
+    std::vector<PackedMove>& buffer;
+    const MoveOrdering* ordering;
+    // Hash move, killers and countermove; the ones not handed out are nulled.
+    std::array<PackedMove, 4> special;
+    size_t special_index {1};
+    size_t scoring_end {0};
+    Stage stage {Stage::HASH};
+    size_t cursor {0};
+};
+
+
+// ---- RiverNetwork Implementation ----
+
+template <typename Geo>
+void RiverNetwork<Geo>::build(const FastBoard& board) {
+    tracked = board.all_rivers();
+    tracked.for_each([&](int idx) { compute_edges(board, idx); });
+    saved_rivers.clear();
+    frames.clear();
+    saved_rivers.reserve(256);
+    frames.reserve(64);
+}
+
+// Ray d (0 or 1) of the river on idx, in the same order explore_river_network walks them.
+template <typename Geo>
+std::pair<int, int> RiverNetwork<Geo>::ray_direction(const FastBoard& board, int idx, int d) {
+    const bool is_horizontal = (board.at(idx).orientation == Orientation::HORIZONTAL);
+    const int step = (d == 0) ? 1 : -1;
+    return is_horizontal ? std::pair<int, int>{step, 0} : std::pair<int, int>{0, step};
+}
+
+// Walks both rays once, filling the edges for both players: their flows only
+// differ where one of them reaches its rival's score cells.
+template <typename Geo>
+void RiverNetwork<Geo>::compute_edges(const FastBoard& board, int idx) {
+    ray_cells[idx] = Bitboard{};
+    edges[0][idx] = RiverEdges{};
+    edges[1][idx] = RiverEdges{};
+    for (int d = 0; d < 2; ++d) {
+        const auto [dx, dy] = ray_direction(board, idx, d);
+        std::array<bool, 2> open {{true, true}};
+        int nx = cell_x(idx) + dx;
+        int ny = cell_y(idx) + dy;
+        while (Geo::in_bounds(nx, ny) && (open[0] || open[1])) {
+            const int flat_idx = cell_index(nx, ny);
+            const uint8_t code = board.code_at(flat_idx);
+            ray_cells[idx].set(flat_idx);
+            for (int slot = 0; slot < 2; ++slot) {
+                if (!open[slot]) continue;
+                RiverEdges& river = edges[slot][idx];
+                river.ray_end[d] = flat_idx;
+                // Flow stops before the rival's score cells
+                if (rival_area(slot).test(flat_idx)) {
+                    open[slot] = false;
+                } else if (code == EMPTY) {
+                    river.destinations.set(flat_idx);
+                } else {
+                    if (piece_from_code(code).side == Side::RIVER) river.successor[d] = flat_idx;
+                    open[slot] = false;
+                }
+            }
+            nx += dx; ny += dy;
+        }
+    }
+}
+
+template <typename Geo>
+void RiverNetwork<Geo>::apply(const FastBoard& board, PackedMove move) {
+    frames.push_back(Frame{saved_rivers.size(), tracked});
+
+    Bitboard changed;
+    changed.set(move.from());
+    if (move.action() == ActionType::MOVE || move.action() == ActionType::PUSH) changed.set(move.to());
+    if (move.action() == ActionType::PUSH) changed.set(move.pushed_to());
+
+    // Rivers on a changed cell, plus every river whose ray crosses one.
+    // Rays are straight, so only rivers sharing a row or column can be affected.
+    Bitboard dirty = changed;
+    Bitboard candidates;
+    changed.for_each([&](int idx) { candidates |= ROW_MASK[cell_y(idx)] | COL_MASK[cell_x(idx)]; });
+    (candidates & tracked).for_each([&](int idx) {
+        if ((ray_cells[idx] & changed).any()) dirty.set(idx);
+    });
+
+    tracked = board.all_rivers();
+    (dirty & tracked).for_each([&](int idx) {
+        saved_rivers.push_back(SavedRiver{idx, {{edges[0][idx], edges[1][idx]}}, ray_cells[idx]});
+        compute_edges(board, idx);
+    });
+}
+
+template <typename Geo>
+void RiverNetwork<Geo>::revert() {
+    const Frame& frame = frames.back();
+    for (size_t i = saved_rivers.size(); i-- > frame.first_saved;) {
+        const SavedRiver& river = saved_rivers[i];
+        edges[0][river.idx] = river.edges[0];
+        edges[1][river.idx] = river.edges[1];
+        ray_cells[river.idx] = river.ray_cells;
+    }
+    saved_rivers.resize(frame.first_saved);
+    tracked = frame.tracked;
+    frames.pop_back();
+}
+
+template <typename Geo>
+Bitboard RiverNetwork<Geo>::flow_destinations(const FastBoard& board, int start_idx, int moving_idx, Player player, Bitboard* touched) const {
+    const int slot = player_slot(player);
+    Bitboard result;
+    Bitboard visited_river;
+    std::array<int16_t, MAX_CELLS> to_visit; // Each river is queued at most once, and the walk crosses rivers of both sides
+    int tail = 0;
+
+    to_visit[tail++] = start_idx;
+    visited_river.set(start_idx);
+    auto visit = [&](int next) {
+        if (!visited_river.test(next)) {
+            visited_river.set(next);
+            to_visit[tail++] = next;
+        }
+    };
+    while (tail > 0) {
+        const int idx = to_visit[--tail];
+        const RiverEdges& river = edges[slot][idx];
+        result |= river.destinations;
+        if (touched) {
+            touched->set(idx);
+            *touched |= ray_cells[idx];
+        }
+        for (int d = 0; d < 2; ++d) {
+            if (river.ray_end[d] != moving_idx) {
+                if (river.successor[d] >= 0) visit(river.successor[d]);
+                continue;
+            }
+            // The ray stopped on the mover's own square, but flow passes through it.
+            if (rival_area(slot).test(moving_idx)) continue;
+            const auto [dx, dy] = ray_direction(board, idx, d);
+            int nx = cell_x(moving_idx) + dx;
+            int ny = cell_y(moving_idx) + dy;
+            while (Geo::in_bounds(nx, ny)) {
+                const int flat_idx = cell_index(nx, ny);
+                if (rival_area(slot).test(flat_idx)) break;
+                if (touched) touched->set(flat_idx);
+                const uint8_t code = board.code_at(flat_idx);
+                if (code == EMPTY) {
+                    result.set(flat_idx);
+                } else {
+                    if (piece_from_code(code).side == Side::RIVER) visit(flat_idx);
+                    break;
+                }
+                nx += dx; ny += dy;
+            }
+        }
+    }
+    assert(result == MoveGenerator<Geo>::explore_river_network(board, cell_x(start_idx), cell_y(start_idx), cell_x(moving_idx), cell_y(moving_idx), player, false));
+    return result;
+}
+
+// ---- Scores ----
+// Evaluation and search scores are plain integers, so comparisons (and root
+// ties) are exact. Weights are fixed-point with WEIGHT_SCALE units per 1.0;
+// a weighted sum is divided by WEIGHT_SCALE once, truncating like the int
+// conversion it replaces.
+using Score = int32_t;
+constexpr Score WEIGHT_SCALE = 100;
+constexpr Score SCORE_INFINITY = std::numeric_limits<Score>::max();
+
+constexpr Score fixed_weight(double weight) {
+    return static_cast<Score>(weight * WEIGHT_SCALE + (weight < 0 ? -0.5 : 0.5));
+}
+
+// Saturates a widened score bound to (-SCORE_INFINITY, SCORE_INFINITY).
+constexpr Score clamp_score(int64_t score) {
+    return static_cast<Score>(std::clamp<int64_t>(score, -SCORE_INFINITY, SCORE_INFINITY));
+}
+
+// ---- Evaluation Parameters ----
+/**
+ * @brief Board-size dependent evaluation tuning.
+ *
+ * max_river_distance/highway_max_dist shape the river terms and are fixed at
+ * compile time; the weights and near-win constants are the defaults of the
+ * tunable EvalWeights (see below). Weights are in fixed point (see fixed_weight).
+ * use_component_weights: take the friendly/opponent multipliers given to the
+ * TacticalEvaluator (set_heuristic_weights) instead of the ones below.
+ */
+template <typename Geo> struct EvalParams;
+
+// --- SMALL ---
+template <> struct EvalParams<SmallBoard> {
+    static constexpr Score attack_weight = fixed_weight(2.0);
+    static constexpr Score river_weight = fixed_weight(2.0);
+    static constexpr Score defense_weight = fixed_weight(3.2);
+    static constexpr bool use_component_weights = false;
+    static constexpr Score friendly_weight = fixed_weight(1.2);
+    static constexpr Score opponent_weight = fixed_weight(-2.60);
+    static constexpr int max_river_distance = 4;
+    static constexpr int highway_max_dist = 6;
+    static constexpr int near_win_base = 5000;
+    static constexpr int near_win_decay = 1000;
+};
+
+// --- MEDIUM (aggressive) ---
+// Balanced attack + river
+template <> struct EvalParams<MediumBoard> {
+    static constexpr Score attack_weight = fixed_weight(2.0);
+    static constexpr Score river_weight = fixed_weight(3.0);
+    static constexpr Score defense_weight = fixed_weight(2.0);
+    static constexpr bool use_component_weights = false;
+    static constexpr Score friendly_weight = fixed_weight(1.0);
+    static constexpr Score opponent_weight = fixed_weight(-2.40);
+    static constexpr int max_river_distance = 8;
+    static constexpr int highway_max_dist = 8;
+    static constexpr int near_win_base = 7000;
+    static constexpr int near_win_decay = 1200;
+};
+
+// --- LARGE (aggressive) ---
+// Mobility + highways prioritized
+template <> struct EvalParams<LargeBoard> {
+    static constexpr Score attack_weight = fixed_weight(6.0);
+    static constexpr Score river_weight = fixed_weight(10.0);
+    static constexpr Score defense_weight = fixed_weight(2.0);
+    static constexpr bool use_component_weights = true;
+    static constexpr Score friendly_weight = fixed_weight(0.0); // Unused
+    static constexpr Score opponent_weight = fixed_weight(0.0); // Unused
+    static constexpr int max_river_distance = 10;
+    static constexpr int highway_max_dist = 10;
+    static constexpr int near_win_base = 10000;
+    static constexpr int near_win_decay = 1500;
+};
+
+/**
+ * @brief The tunable part of the evaluation for one board size: what the
+ * Texel tuner fits and what an eval params file sets. Starts out as EvalParams<Geo>.
+ */
+struct EvalWeights {
+    Score attack_weight;
+    Score river_weight;
+    Score defense_weight;
+    Score friendly_weight;
+    Score opponent_weight;
+    int near_win_base;
+    int near_win_decay;
+
+    template <typename Geo>
+    static constexpr EvalWeights defaults() {
+        using Params = EvalParams<Geo>;
+        return {Params::attack_weight, Params::river_weight, Params::defense_weight,
+                Params::friendly_weight, Params::opponent_weight, Params::near_win_base, Params::near_win_decay};
+    }
+};
+
+// Attack score of a single piece, by [player slot][side][cell]: the "gravity"
+// buckets below applied to the goal distance table once per board size.
+template <typename Geo>
+constexpr std::array<std::array<std::array<int32_t, MAX_CELLS>, 2>, 2> make_proximity_table() {
+    // Weights for "Gravity"
+    constexpr int SCORE_STONE_IN_GOAL = 50000; // Massive reward -> locks piece in place
+    constexpr int SCORE_RIVER_IN_GOAL = 20000; // High reward -> incentivizes entering goal
+    constexpr int SCORE_DIST_1        = 2000;  // Doorstep
+    constexpr int SCORE_DIST_2        = 1000;   // Approach
+    constexpr int SCORE_DIST_3        = 500;   // Setup
+
+    std::array<std::array<std::array<int32_t, MAX_CELLS>, 2>, 2> table {};
+    for (Player player : {Player::SQUARE, Player::CIRCLE}) {
+        auto& stone_scores = table[player_slot(player)][static_cast<int>(Side::STONE)];
+        auto& river_scores = table[player_slot(player)][static_cast<int>(Side::RIVER)];
+        for (int y = 0; y < Geo::rows; ++y) {
+            for (int x = 0; x < Geo::cols; ++x) {
+                const int idx = cell_index(x, y);
+                const int dist = Geo::distance_to_goal(idx, player);
+                int score_contribution = 0;
+                if (dist == 1) score_contribution = SCORE_DIST_1;
+                else if (dist == 2) score_contribution = SCORE_DIST_2;
+                else if (dist == 3) score_contribution = SCORE_DIST_3;
+                else if (dist > 0 && dist < 8) score_contribution = (10 - dist) * 10; // Minimal trail
+                // INSIDE the score area a River is worth less than a Stone.
+                // This difference (50k vs 20k) forces the bot to FLIP to stone.
+                stone_scores[idx] = (dist == 0) ? SCORE_STONE_IN_GOAL : score_contribution;
+                river_scores[idx] = (dist == 0) ? SCORE_RIVER_IN_GOAL : score_contribution;
+            }
+        }
+    }
+    return table;
+}
+
+template <typename Geo>
+constexpr auto PROXIMITY_SCORE = make_proximity_table<Geo>();
+
+// Evaluates the offensive strength based on proximity to the scoring area.
+class AttackManager {
+public:
+    // --- AttackManager ---
+    template <typename Geo>
+    int evaluate_top_pieces_proximity(const FastBoard& board, Player player, Score friendly_weight, Score opponent_weight) const {
+        // We calculate opponent threat using the same logic.
+        // If opponent has a stone in goal, that's bad for us.
+        return combine(proximity_sum<Geo>(board, player), proximity_sum<Geo>(board, opponent(player)), friendly_weight, opponent_weight);
+    }
+
+    // Sum of table entries over one player's stones and rivers
+    template <typename Geo>
+    static int proximity_sum(const FastBoard& board, Player owner) {
+        const auto& scores = PROXIMITY_SCORE<Geo>[player_slot(owner)];
+        int32_t sum = 0;
+        board.stones(owner).for_each([&](int idx) { sum += scores[static_cast<int>(Side::STONE)][idx]; });
+        board.rivers(owner).for_each([&](int idx) { sum += scores[static_cast<int>(Side::RIVER)][idx]; });
+        return sum;
+    }
+
+    // Fixed-point weighted sum of a friendly and an opponent score
+    static int combine(int friendly_score, int opponent_score, Score friendly_weight, Score opponent_weight) {
+        return static_cast<int>((int64_t{friendly_weight} * friendly_score + int64_t{opponent_weight} * opponent_score) / WEIGHT_SCALE);
+    }
+};
+
+// Evaluates the board from a defensive perspective.
+class DefenseManager {
+public:
+    // --- DefenseManager ---
+    template <typename Geo>
+    int penalty_for_blocked_score_zone(const FastBoard& board, Player player) const {
+        int penalty = 0;
+
+        // Own rivers parked on our own scoring cells
+        const Bitboard blocked = board.rivers(player) & Geo::own_score_mask(player);
+        penalty -= 10000 * blocked.count();
+        return penalty;
+    }
+};
+
+// Highway score by how much closer to the goal a river reaches (see analyze_river).
+constexpr std::array<int, 13> DISTANCE_POWER = {1, 3, 8, 20, 50, 250, 500, 1000, 2000, 4000, 8000, 10000, 16000};
+
+// Evaluates the strategic value of river networks.
+class RiverNetworkManager {
+public:
+    // --- RiverNetworkManager ---
+    // Per-river terms of the evaluation; summed over rivers they are the
+    // friendly/opponent river potential and the highway potential.
+    struct RiverTerms {
+        int friendly {0};
+        int opponent {0};
+        int highway {0};
+
+        RiverTerms& operator+=(const RiverTerms& o) { friendly += o.friendly; opponent += o.opponent; highway += o.highway; return *this; }
+        RiverTerms& operator-=(const RiverTerms& o) { friendly -= o.friendly; opponent -= o.opponent; highway -= o.highway; return *this; }
+        bool operator==(const RiverTerms& o) const { return friendly == o.friendly && opponent == o.opponent && highway == o.highway; }
+    };
+
+    // One pass over every river on the board.
+    template <typename Geo>
+    static RiverTerms analyze_rivers(const FastBoard& board, Player player, const RiverNetwork<Geo>* network = nullptr) {
+        RiverTerms totals;
+        board.all_rivers().for_each([&](int idx) { totals += analyze_river<Geo>(board, idx, player, network); });
+        return totals;
+    }
+
+    /**
+     * @brief Everything the evaluation reads from one river, from `player`'s view.
+     *
+     * friendly/opponent: how close to their goal the first friendly/opponent
+     * stone next to the river could flow, times the number of such stones
+     * (zero for rivers on a score row).
+     * highway: for the player's own rivers, how close to the goal the river
+     * itself could flow, on the DISTANCE_POWER scale. The neighbours are
+     * scanned once and each term costs one flow over `network` (or one BFS
+     * without it).
+     *
+     * @param touched Optional; every cell the result was read from is added to
+     *        it (needs `network`). EvalState uses it to know when to recompute.
+     */
+    template <typename Geo>
+    static RiverTerms analyze_river(const FastBoard& board, int idx, Player player, const RiverNetwork<Geo>* network, Bitboard* touched = nullptr) {
+        constexpr int max_river_distance = EvalParams<Geo>::max_river_distance;
+        constexpr int max_highway_distance = EvalParams<Geo>::highway_max_dist;
+        const Player opponent_player = opponent(player); 
+        RiverTerms terms;
+        if (touched) touched->set(idx);
+
+        auto flow = [&](int moving_idx, Player mover_owner) {
+            return network ? network->flow_destinations(board, idx, moving_idx, mover_owner, touched)
+                           : MoveGenerator<Geo>::explore_river_network(board, cell_x(idx), cell_y(idx), cell_x(moving_idx), cell_y(moving_idx), mover_owner, false);
+        };
+
+        // Highway: the river itself is the "mover"
+        if (board.at(idx).player == player) {
+            const int best_dist = closest_to_goal<Geo>(flow(idx, player), player);
+            const int score_contribution = max_highway_distance - best_dist;
+            // Halved: less valuable than a piece *already* on that square, but still worth building.
+            if (score_contribution >= 0) terms.highway = DISTANCE_POWER[score_contribution] / 2;
+        }
+
+        // Rivers on either score row have no river potential
+        if (Geo::is_own_score_cell(idx, player) || Geo::is_rival_score_cell(idx, player)) return terms;
+
+        int friendly_stones_near = 0;
+        int opponent_stones_near = 0;
+        int friendly_stone_idx = -1;
+        int opponent_stone_idx = -1;
         
-        for (const auto& cell_coords : my_scoring_cells) {
-            int x = cell_coords.first;
-            int y = cell_coords.second;
-            const auto& cell = board[y][x];
+        for (const auto& [dx, dy] : {std::pair{1,0}, {-1,0}, {0,1}, {0,-1}}) {
+            const int adj_x = cell_x(idx) + dx;
+            const int adj_y = cell_y(idx) + dy;
+            
+            if (!Geo::in_bounds(adj_x, adj_y)) continue;
             
-            if (cell.isEmpty()) {
-                empty_goal_cell = {x, y};
-            } else if (cell.player == player && cell.side == Side::STONE) {
-                pieces_in_goal++;
+            const int adj_idx = cell_index(adj_x, adj_y);
+            if (touched) touched->set(adj_idx);
+            const Piece adj_cell = board.at(adj_idx);
+            if (adj_cell.isEmpty() || Geo::is_own_score_cell(adj_idx, player) || Geo::is_rival_score_cell(adj_idx, player)) continue;
+            
+            if (adj_cell.player == player) {
+                friendly_stones_near++;
+                if (friendly_stone_idx == -1) friendly_stone_idx = adj_idx;
+            } else {
+                opponent_stones_near++;
+                if (opponent_stone_idx == -1) opponent_stone_idx = adj_idx;
             }
         }
         
+        if (friendly_stones_near > 0) {
+            const int distance = std::min(closest_to_goal<Geo>(flow(friendly_stone_idx, player), player), max_river_distance);
+            terms.friendly = (max_river_distance - distance) * friendly_stones_near;
+        }
+        if (opponent_stones_near > 0) {
+            const int distance = std::min(closest_to_goal<Geo>(flow(opponent_stone_idx, opponent_player), opponent_player), max_river_distance);
+            terms.opponent = (max_river_distance - distance) * opponent_stones_near;
+        }
+        return terms;
+    }
+
+private:
+    // Smallest goal distance among `cells`, or NO_DISTANCE if there are none.
+    static constexpr int NO_DISTANCE = 99;
+    template <typename Geo>
+    static int closest_to_goal(const Bitboard& cells, Player player) {
+        int best = NO_DISTANCE;
+        cells.for_each([&](int cell) { best = std::min(best, Geo::distance_to_goal(cell, player)); });
+        return best;
+    }
+};
+
+template <typename Geo> class EvalState;
+
+// ---- Main TacticalEvaluator Class ----
+// Heuristic methods are policy types (defined after TacticalEvaluator); the
+// search is instantiated per method, so the call resolves at compile time.
+struct FinalEvaluation;
+
+class TacticalEvaluator {
+public:
+    // Weights are converted to fixed point once, here and in update_evaluation_weights.
+    TacticalEvaluator(double friendly_weight, double opponent_weight) 
+        : weights_{{EvalWeights::defaults<SmallBoard>(), EvalWeights::defaults<MediumBoard>(), EvalWeights::defaults<LargeBoard>()}} {
+        update_evaluation_weights(friendly_weight, opponent_weight);
+    }
+
+    // Everything the evaluation reads from a board, before any weight is applied.
+    struct EvalFeatures {
+        int attack_friendly {0};    // AttackManager::proximity_sum of each side
+        int attack_opponent {0};
+        int river_friendly {0};     // RiverTerms totals
+        int river_opponent {0};
+        int highway {0};
+        int defense {0};            // Already a penalty (<= 0)
+        int near_win_distance {-1}; // See near_win_distance(); -1 for no bonus
+    };
+
+    // The terms final_evaluation adds up, before the attack/river/defense weights.
+    struct EvalComponents {
+        int attack {0};
+        int river {0};
+        int defense {0};
+        int highway {0};
+        int near_win {0};
+    };
+
+    // With `state` (in sync with `board` and `network`), the attack and river
+    // terms come from its running totals instead of a full board scan.
+    template <typename Geo>
+    Score final_evaluation(const FastBoard& board, Player player, const RiverNetwork<Geo>* network, EvalState<Geo>* state = nullptr) const {
+        return combine_components(evaluation_components<Geo>(board, player, network, state), weights<Geo>());
+    }
+
+    template <typename Geo>
+    EvalComponents evaluation_components(const FastBoard& board, Player player, const RiverNetwork<Geo>* network = nullptr, EvalState<Geo>* state = nullptr) const {
+        return components_from(evaluation_features<Geo>(board, player, network, state), weights<Geo>());
+    }
+
+    template <typename Geo>
+    EvalFeatures evaluation_features(const FastBoard& board, Player player, const RiverNetwork<Geo>* network = nullptr, EvalState<Geo>* state = nullptr) const {
+        EvalFeatures features;
+        RiverNetworkManager::RiverTerms rivers;
+        if (state && network) {
+            assert(state->perspective() == player);
+            features.attack_friendly = state->proximity_sum(player);
+            features.attack_opponent = state->proximity_sum(opponent(player));
+            rivers = state->river_totals(board, *network);
+            // In debug builds make sure the running totals never drift.
+            assert(features.attack_friendly == AttackManager::proximity_sum<Geo>(board, player));
+            assert(features.attack_opponent == AttackManager::proximity_sum<Geo>(board, opponent(player)));
+            assert(rivers == RiverNetworkManager::analyze_rivers<Geo>(board, player, network));
+        } else {
+            features.attack_friendly = AttackManager::proximity_sum<Geo>(board, player);
+            features.attack_opponent = AttackManager::proximity_sum<Geo>(board, opponent(player));
+            rivers = RiverNetworkManager::analyze_rivers<Geo>(board, player, network);
+        }
+        features.river_friendly = rivers.friendly;
+        features.river_opponent = rivers.opponent;
+        features.highway = rivers.highway;
+        features.defense = defense_manager.penalty_for_blocked_score_zone<Geo>(board, player);
+        features.near_win_distance = near_win_distance<Geo>(board, player);
+        return features;
+    }
+
+    static EvalComponents components_from(const EvalFeatures& features, const EvalWeights& weights) {
+        EvalComponents components;
+        components.attack = AttackManager::combine(features.attack_friendly, features.attack_opponent, weights.friendly_weight, weights.opponent_weight);
+        components.river = AttackManager::combine(features.river_friendly, features.river_opponent, weights.friendly_weight, weights.opponent_weight);
+        components.defense = features.defense;
+        components.highway = features.highway;
+        //  Bonus decreases with distance
+        if (features.near_win_distance >= 0) {
+            components.near_win = std::max(0, weights.near_win_base - features.near_win_distance * weights.near_win_decay);
+        }
+        return components;
+    }
+
+    static Score combine_components(const EvalComponents& components, const EvalWeights& weights) {
+        constexpr Score near_win_weight = fixed_weight(0.9);
+        const int64_t total = int64_t{weights.attack_weight} * components.attack
+                            + int64_t{weights.river_weight} * components.river
+                            + int64_t{weights.defense_weight} * components.defense
+                            + int64_t{WEIGHT_SCALE} * components.highway
+                            + int64_t{near_win_weight} * components.near_win;
+        return static_cast<Score>(total / WEIGHT_SCALE);
+    }
+
+    /**
+     * @brief Closing logic: once the player has 3+ stones on its score row and
+     * a score cell is still empty, the Manhattan distance from that cell to the
+     * closest own piece next to the score row. -1 if there is no such piece.
+     * The bonus is near_win_base - distance * near_win_decay (never negative).
+     */
+    template <typename Geo>
+    static int near_win_distance(const FastBoard& board, Player player) {
+        // Count pieces in goal and find empty cell
+        const Bitboard& my_scoring_cells = Geo::own_score_mask(player);
+        const int pieces_in_goal = (board.stones(player) & my_scoring_cells).count();
+        
         //  CONDITION: Must have at least 3 pieces in scoring area
-        if (pieces_in_goal < 3 || empty_goal_cell.first == -1) {
-            return 0;
+        if (pieces_in_goal < 3) {
+            return -1;
+        }
+        int empty_goal_idx = -1;
+        (board.pieces[EMPTY] & my_scoring_cells).for_each([&](int idx) { empty_goal_idx = idx; });
+        if (empty_goal_idx == -1) {
+            return -1;
         }
+        const int empty_x = cell_x(empty_goal_idx), empty_y = cell_y(empty_goal_idx);
         
         //  Find 4th piece adjacent to scoring zone
-        auto adjacent_positions = get_adjacent_to_scoring_zone(player, rows, cols, score_cols);
+        int best_distance = -1;
+        for (int adj_idx : Geo::SCORE_ZONE_NEIGHBOURS[player_slot(player)]) {
+            const Piece cell = board.at(adj_idx);
+            if (cell.isEmpty() || cell.player != player) continue;
+            
+            //  Calculate Manhattan distance to empty goal cell
+            const int manhattan_dist = std::abs(empty_x - cell_x(adj_idx)) + 
+                                       std::abs(empty_y - cell_y(adj_idx));
+            if (best_distance == -1 || manhattan_dist < best_distance) best_distance = manhattan_dist;
+        }
         
-        // Board-size dependent parameters
-        int BASE_VALUE, DECAY;
-        if (rows >= 17) {
-            BASE_VALUE = 10000;
-            DECAY = 1500;
-        } else if (rows >= 15) {
-            BASE_VALUE = 7000;
-            DECAY = 1200;
-        } else {
-            BASE_VALUE = 5000;
-            DECAY = 1000;
+        return best_distance;
+    }
+
+    template <typename Geo>
+    const EvalWeights& weights() const { return weights_[geometry_slot<Geo>()]; }
+    template <typename Geo>
+    void set_weights(const EvalWeights& weights) { weights_[geometry_slot<Geo>()] = weights; }
+
+    // Friendly/opponent weights of the board sizes with use_component_weights.
+    void update_evaluation_weights(double friendly_weight, double opponent_weight) {
+        set_component_weights<SmallBoard>(friendly_weight, opponent_weight);
+        set_component_weights<MediumBoard>(friendly_weight, opponent_weight);
+        set_component_weights<LargeBoard>(friendly_weight, opponent_weight);
+    }
+
+    // Eval params files: see load_eval_weights/save_eval_weights.
+    void load_weights(const std::string& path);
+    void save_weights(const std::string& path) const;
+
+    // `network`, when given, must be in sync with `board`; river flows are then read from it.
+    // `state`, when given, must be in sync too (see EvalState).
+    template <typename Geo, typename Method = FinalEvaluation>
+    Score evaluate_board_state(const FastBoard& board, Player player, const RiverNetwork<Geo>* network = nullptr, EvalState<Geo>* state = nullptr) const {
+        return Method::template evaluate<Geo>(*this, board, player, network, state);
+    }
+
+    // Name-selected evaluation, for callers outside the search (Python).
+    template <typename Geo>
+    Score evaluate_with_method(const FastBoard& board, Player player, std::string_view method) const;
+
+private:
+    template <typename Geo>
+    void set_component_weights(double friendly_weight, double opponent_weight) {
+        if constexpr (EvalParams<Geo>::use_component_weights) {
+            weights_[geometry_slot<Geo>()].friendly_weight = fixed_weight(friendly_weight);
+            weights_[geometry_slot<Geo>()].opponent_weight = fixed_weight(opponent_weight);
+        }
+    }
+
+    std::array<EvalWeights, NUM_GEOMETRIES> weights_; // By geometry_slot
+    
+    DefenseManager defense_manager;
+};
+
+// ---- Heuristic methods ----
+// Each one is a stateless policy with a name (for evaluate_with_method) and
+// a static evaluate() with the signature of evaluate_board_state.
+struct FinalEvaluation {
+    static constexpr std::string_view name = "Final_Evaluation";
+
+    template <typename Geo>
+    static Score evaluate(const TacticalEvaluator& evaluator, const FastBoard& board, Player player, const RiverNetwork<Geo>* network, EvalState<Geo>* state) {
+        return evaluator.final_evaluation<Geo>(board, player, network, state);
+    }
+};
+
+/**
+ * @brief Calls f(Method{}) for the heuristic method called `method`; throws
+ * std::invalid_argument (ValueError in Python) for an unknown name.
+ */
+template <typename F>
+decltype(auto) dispatch_heuristic(std::string_view method, F&& f) {
+    if (method == FinalEvaluation::name) return f(FinalEvaluation{});
+    throw std::invalid_argument("Unknown evaluation method: " + std::string(method));
+}
+
+template <typename Geo>
+Score TacticalEvaluator::evaluate_with_method(const FastBoard& board, Player player, std::string_view method) const {
+    return dispatch_heuristic(method, [&](auto heuristic) {
+        using Method = decltype(heuristic);
+        return evaluate_board_state<Geo, Method>(board, player);
+    });
+}
+
+// ---- Eval params files ----
+// One line per board size, weights as decimals (see fixed_weight), '#' starts
+// a comment. Sizes a file does not list keep the weights they had:
+//   rows cols attack river defense friendly opponent near_win_base near_win_decay
+void TacticalEvaluator::load_weights(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::invalid_argument("Cannot open eval params file: " + path);
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number) {
+        line.erase(std::min(line.find('#'), line.size()));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        std::istringstream fields(line);
+        int rows = 0, cols = 0;
+        double attack, river, defense, friendly, opponent_w;
+        EvalWeights weights;
+        if (!(fields >> rows >> cols >> attack >> river >> defense >> friendly >> opponent_w >> weights.near_win_base >> weights.near_win_decay)) {
+            throw std::invalid_argument(path + ":" + std::to_string(line_number) + ": expected 9 fields");
+        }
+        weights.attack_weight = fixed_weight(attack);
+        weights.river_weight = fixed_weight(river);
+        weights.defense_weight = fixed_weight(defense);
+        weights.friendly_weight = fixed_weight(friendly);
+        weights.opponent_weight = fixed_weight(opponent_w);
+        dispatch_board_size(rows, cols, [&](auto geometry) { set_weights<decltype(geometry)>(weights); });
+    }
+}
+
+void TacticalEvaluator::save_weights(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) throw std::invalid_argument("Cannot write eval params file: " + path);
+    const auto decimal = [](Score weight) { return static_cast<double>(weight) / WEIGHT_SCALE; };
+    out << "# rows cols attack river defense friendly opponent near_win_base near_win_decay\n" << std::fixed << std::setprecision(2);
+    const auto write = [&](auto geometry) {
+        using Geo = decltype(geometry);
+        const EvalWeights& w = weights<Geo>();
+        out << Geo::rows << ' ' << Geo::cols << ' ' << decimal(w.attack_weight) << ' ' << decimal(w.river_weight) << ' '
+            << decimal(w.defense_weight) << ' ' << decimal(w.friendly_weight) << ' ' << decimal(w.opponent_weight) << ' '
+            << w.near_win_base << ' ' << w.near_win_decay << '\n';
+    };
+    write(SmallBoard{});
+    write(MediumBoard{});
+    write(LargeBoard{});
+}
+
+// ---- BoardSimulator Class  ----
+/**
+ * @brief What make_move overwrote, so unmake_move can put it back.
+ */
+struct UndoRecord {
+    PackedMove move;
+    uint8_t from_code {EMPTY};
+    uint8_t to_code {EMPTY};
+    uint8_t pushed_code {EMPTY};
+};
+
+class BoardSimulator {
+public:
+    // Applies a move in place and records the overwritten cells in `undo`.
+    static void make_move(FastBoard& board, PackedMove move, UndoRecord& undo) {
+        const int from_idx = move.from();
+        const uint8_t mover = board.code_at(from_idx);
+        undo.move = move;
+        undo.from_code = mover;
+        switch (move.action()) {
+            case ActionType::MOVE:
+                undo.to_code = board.code_at(move.to());
+                board.put(move.to(), mover);
+                board.put(from_idx, EMPTY);
+                break;
+            case ActionType::PUSH:
+                undo.to_code = board.code_at(move.to());
+                undo.pushed_code = board.code_at(move.pushed_to());
+                board.put(move.pushed_to(), undo.to_code);
+                // A river that pushes turns back into a stone (engine rule)
+                board.put(move.to(), stone_code(piece_from_code(mover).player));
+                board.put(from_idx, EMPTY);
+                break;
+            case ActionType::FLIP: {
+                const Piece piece = piece_from_code(mover);
+                if (piece.side == Side::STONE) {
+                    board.put(from_idx, mover + ((move.orientation() == Orientation::VERTICAL) ? 2 : 1)); // Default horizontal
+                } else {
+                    board.put(from_idx, stone_code(piece.player)); // Stone has no orientation
+                }
+                break;
+            }
+            case ActionType::ROTATE: {
+                const Piece piece = piece_from_code(mover);
+                board.put(from_idx, stone_code(piece.player) + ((piece.orientation == Orientation::HORIZONTAL) ? 2 : 1));
+                break;
+            }
+        }
+    }
+
+    // Restores the board to exactly what it was before the matching make_move.
+    static void unmake_move(FastBoard& board, const UndoRecord& undo) {
+        const PackedMove move = undo.move;
+        switch (move.action()) {
+            case ActionType::PUSH:
+                board.put(move.pushed_to(), undo.pushed_code);
+                [[fallthrough]];
+            case ActionType::MOVE:
+                board.put(move.to(), undo.to_code);
+                break;
+            case ActionType::FLIP:
+            case ActionType::ROTATE:
+                break;
+        }
+        board.put(move.from(), undo.from_code);
+    }
+
+    // Copying convenience wrapper around make_move, for callers outside the search.
+    static FastBoard get_next_board_state(const FastBoard& board, PackedMove move) {
+        FastBoard next_state = board;
+        UndoRecord undo;
+        make_move(next_state, move, undo);
+        return next_state;
+    }
+
+    template <typename Geo>
+    static bool is_win_state(const FastBoard& board) {
+        if ((board.stones(Player::CIRCLE) & Geo::own_score_mask(Player::CIRCLE)).count() >= Geo::score_width) return true;
+        return (board.stones(Player::SQUARE) & Geo::own_score_mask(Player::SQUARE)).count() >= Geo::score_width;
+    }
+
+    // Either side one stone short of a win.
+    template <typename Geo>
+    static bool is_near_win(const FastBoard& board) {
+        if ((board.stones(Player::CIRCLE) & Geo::own_score_mask(Player::CIRCLE)).count() >= Geo::score_width - 1) return true;
+        return (board.stones(Player::SQUARE) & Geo::own_score_mask(Player::SQUARE)).count() >= Geo::score_width - 1;
+    }
+};
+
+// ---- EvalState (incremental evaluation) ----
+/**
+ * @brief Running totals for the attack, river and highway terms of
+ * final_evaluation, from one player's point of view, kept in sync with the
+ * search board the same way RiverNetwork is.
+ *
+ * The attack term is a sum of per-cell table entries, so apply() just swaps
+ * the entries of the 1-3 cells a move changed. The river and highway terms are
+ * per-river sums; each river's share is cached together with every cell it was
+ * read from, and a move only drops the shares that read a changed cell. The
+ * dropped rivers are recomputed lazily by river_totals(), i.e. only at nodes
+ * that actually get evaluated.
+ */
+template <typename Geo>
+class EvalState {
+public:
+    using RiverTerms = RiverNetworkManager::RiverTerms;
+
+    void build(const FastBoard& board, Player player);
+    // Call right after make_move(move). Calls must be undone in LIFO order.
+    void apply(const FastBoard& board, const UndoRecord& undo);
+    // Call right after unmake_move of the most recently applied move.
+    void revert();
+
+    Player perspective() const { return player; }
+    int proximity_sum(Player owner) const { return attack[player_slot(owner)]; }
+    // `network` must be in sync with `board`.
+    const RiverTerms& river_totals(const FastBoard& board, const RiverNetwork<Geo>& network);
+
+private:
+    struct CachedTerms {
+        RiverTerms terms;
+        Bitboard depends_on;
+    };
+
+    static int proximity_of(uint8_t code, int idx) {
+        if (code == EMPTY) return 0;
+        const Piece piece = piece_from_code(code);
+        return PROXIMITY_SCORE<Geo>[player_slot(piece.player)][static_cast<int>(piece.side)][idx];
+    }
+    void update_cell(int idx, uint8_t old_code, uint8_t new_code, Bitboard& changed);
+
+    Player player {Player::NONE};
+    std::array<int, 2> attack {};
+    RiverTerms totals;
+    Bitboard valid;                       // Rivers whose terms are counted in totals
+    std::array<CachedTerms, MAX_CELLS> cached;
+
+    // Undo stack for apply()/revert()
+    struct SavedTerms {
+        int idx;
+        CachedTerms entry;
+    };
+    struct Frame {
+        size_t first_saved;
+        std::array<int, 2> attack;
+        RiverTerms totals;
+        Bitboard valid;
+    };
+    std::vector<SavedTerms> saved_terms;
+    std::vector<Frame> frames;
+};
+
+template <typename Geo>
+void EvalState<Geo>::build(const FastBoard& board, Player perspective_player) {
+    player = perspective_player;
+    attack[player_slot(Player::SQUARE)] = AttackManager::proximity_sum<Geo>(board, Player::SQUARE);
+    attack[player_slot(Player::CIRCLE)] = AttackManager::proximity_sum<Geo>(board, Player::CIRCLE);
+    totals = RiverTerms{};
+    valid = Bitboard{};
+    saved_terms.clear();
+    frames.clear();
+}
+
+template <typename Geo>
+void EvalState<Geo>::update_cell(int idx, uint8_t old_code, uint8_t new_code, Bitboard& changed) {
+    if (old_code == new_code) return;
+    if (old_code != EMPTY) attack[player_slot(piece_from_code(old_code).player)] -= proximity_of(old_code, idx);
+    if (new_code != EMPTY) attack[player_slot(piece_from_code(new_code).player)] += proximity_of(new_code, idx);
+    changed.set(idx);
+}
+
+template <typename Geo>
+void EvalState<Geo>::apply(const FastBoard& board, const UndoRecord& undo) {
+    frames.push_back({saved_terms.size(), attack, totals, valid});
+
+    const PackedMove move = undo.move;
+    Bitboard changed;
+    update_cell(move.from(), undo.from_code, board.code_at(move.from()), changed);
+    if (move.action() == ActionType::MOVE || move.action() == ActionType::PUSH) {
+        update_cell(move.to(), undo.to_code, board.code_at(move.to()), changed);
+    }
+    if (move.action() == ActionType::PUSH) {
+        update_cell(move.pushed_to(), undo.pushed_code, board.code_at(move.pushed_to()), changed);
+    }
+
+    valid.for_each([&](int idx) {
+        const CachedTerms& entry = cached[idx];
+        if (!changed.test(idx) && !(entry.depends_on & changed).any()) return;
+        saved_terms.push_back({idx, entry});
+        totals -= entry.terms;
+        valid.reset(idx);
+    });
+}
+
+template <typename Geo>
+void EvalState<Geo>::revert() {
+    const Frame& frame = frames.back();
+    // Entries recomputed since apply() are simply overwritten again
+    for (size_t i = frame.first_saved; i < saved_terms.size(); ++i) cached[saved_terms[i].idx] = saved_terms[i].entry;
+    saved_terms.resize(frame.first_saved);
+    attack = frame.attack;
+    totals = frame.totals;
+    valid = frame.valid;
+    frames.pop_back();
+}
+
+template <typename Geo>
+const typename EvalState<Geo>::RiverTerms& EvalState<Geo>::river_totals(const FastBoard& board, const RiverNetwork<Geo>& network) {
+    board.all_rivers().without(valid).for_each([&](int idx) {
+        CachedTerms& entry = cached[idx];
+        entry.depends_on = Bitboard{};
+        entry.terms = RiverNetworkManager::analyze_river<Geo>(board, idx, player, &network, &entry.depends_on);
+        totals += entry.terms;
+        valid.set(idx);
+    });
+    return totals;
+}
+
+// ---- Perft (move generation check) ----
+/**
+ * @brief Counts the positions reachable in exactly `depth` plies, walking the
+ * tree the way the search does: calculate_possible_actions with a RiverNetwork,
+ * then make/unmake. A won position has no moves, since the game is over.
+ *
+ * perft.py compares these counts with the rules in gameEngine.py, root move
+ * by root move, so any change to move generation can be checked against the referee.
+ */
+template <typename Geo>
+class Perft {
+public:
+    explicit Perft(const FastBoard& root) : board(root) {
+        network.build(board);
+    }
+
+    uint64_t count(Player player, int depth) {
+        if (depth == 0) return 1;
+        if (BoardSimulator::is_win_state<Geo>(board)) return 0;
+        if (move_lists.size() < static_cast<size_t>(depth)) move_lists.resize(depth);
+        std::vector<PackedMove>& moves = move_lists[depth - 1];
+        MoveGenerator<Geo>::calculate_possible_actions(board, player, moves, &network);
+        if (depth == 1) return moves.size(); // Bulk count the last ply
+
+        uint64_t nodes = 0;
+        for (PackedMove move : moves) {
+            nodes += count_after(move, player, depth);
+        }
+        return nodes;
+    }
+
+    // Node count below each root move, in generation order.
+    std::vector<std::pair<PackedMove, uint64_t>> divide(Player player, int depth) {
+        std::vector<std::pair<PackedMove, uint64_t>> result;
+        if (depth == 0 || BoardSimulator::is_win_state<Geo>(board)) return result;
+        for (PackedMove move : MoveGenerator<Geo>::calculate_possible_actions(board, player)) {
+            result.emplace_back(move, count_after(move, player, depth));
+        }
+        return result;
+    }
+
+private:
+    uint64_t count_after(PackedMove move, Player player, int depth) {
+        UndoRecord undo;
+        BoardSimulator::make_move(board, move, undo);
+        network.apply(board, move);
+        const uint64_t nodes = count(opponent(player), depth - 1);
+        BoardSimulator::unmake_move(board, undo);
+        network.revert();
+        return nodes;
+    }
+
+    FastBoard board;
+    RiverNetwork<Geo> network;
+    std::vector<std::vector<PackedMove>> move_lists; // One per remaining depth, reused
+};
+
+/**
+ * @brief perft_divide exposed to Python: (move, node count) for every root move.
+ */
+std::vector<std::pair<Move, uint64_t>> perft_divide(const Board& py_board, int rows, int cols, const std::vector<int>& score_cols, const std::string& player, int depth) {
+    const FastBoard board = convert_pyboard_to_fastboard(py_board, rows, cols);
+    return dispatch_geometry(rows, cols, score_cols, [&](auto geometry) {
+        using Geo = decltype(geometry);
+        std::vector<std::pair<Move, uint64_t>> result;
+        for (const auto& [move, nodes] : Perft<Geo>(board).divide(playerFromStr(player), depth)) {
+            result.emplace_back(move.to_move(), nodes);
+        }
+        return result;
+    });
+}
+
+/**
+ * @brief perft exposed to Python: total node count only.
+ */
+uint64_t perft(const Board& py_board, int rows, int cols, const std::vector<int>& score_cols, const std::string& player, int depth) {
+    const FastBoard board = convert_pyboard_to_fastboard(py_board, rows, cols);
+    return dispatch_geometry(rows, cols, score_cols, [&](auto geometry) {
+        using Geo = decltype(geometry);
+        return Perft<Geo>(board).count(playerFromStr(player), depth);
+    });
+}
+
+// ---- Batch evaluation (offline analysis and tuning) ----
+// Output columns of StudentAgent::evaluate_batch, in order.
+constexpr std::array<const char*, 6> EVAL_BATCH_COLUMNS = {"attack", "river", "defense", "highway", "near_win", "total"};
+
+/**
+ * @brief Evaluates boards [begin, end) of a batch of piece-code boards into the
+ * EVAL_BATCH_COLUMNS arrays. Touches no Python objects, so it can run on any
+ * thread without the GIL.
+ */
+template <typename Geo>
+void evaluate_batch_range(const TacticalEvaluator& evaluator, const uint8_t* boards, const uint8_t* players, size_t begin, size_t end,
+                          const std::array<int32_t*, EVAL_BATCH_COLUMNS.size()>& out) {
+    constexpr size_t cells = Geo::rows * Geo::cols;
+    for (size_t i = begin; i < end; ++i) {
+        const FastBoard board = convert_codes_to_fastboard(boards + i * cells, Geo::rows, Geo::cols);
+        const auto components = evaluator.evaluation_components<Geo>(board, static_cast<Player>(players[i]));
+        out[0][i] = components.attack;
+        out[1][i] = components.river;
+        out[2][i] = components.defense;
+        out[3][i] = components.highway;
+        out[4][i] = components.near_win;
+        out[5][i] = TacticalEvaluator::combine_components(components, evaluator.weights<Geo>());
+    }
+}
+
+// Worker threads for `count` items: `threads`, or every hardware thread for 0.
+inline size_t worker_count(size_t count, int threads) {
+    const size_t requested = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min<size_t>(count, requested));
+}
+
+/**
+ * @brief Calls f(worker, begin, end) for `workers` contiguous chunks of
+ * [0, count), each on its own thread. One worker runs inline.
+ */
+template <typename F>
+void parallel_for(size_t workers, size_t count, F&& f) {
+    if (workers <= 1) {
+        f(size_t{0}, size_t{0}, count);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (size_t w = 0; w < workers; ++w) {
+        pool.emplace_back([&f, w, workers, count] { f(w, count * w / workers, count * (w + 1) / workers); });
+    }
+    for (auto& worker : pool) worker.join();
+}
+
+// ---- TexelTuner Class ----
+/**
+ * @brief Fits the EvalWeights of each board size to game results (Texel's
+ * method): minimizes the mean squared error between a position's result and
+ * sigmoid(K * eval), first over the scaling K, then over the weights by
+ * coordinate descent.
+ *
+ * Dataset, one position per line ('#' starts a comment):
+ *   rows cols player result codes
+ * player is the side to move (1 square, 2 circle), result is 1 / 0.5 / 0 for
+ * that side, and codes is the rows*cols piece codes of evaluate_batch as one
+ * string of digits, row by row.
+ *
+ * EvalFeatures do not depend on the weights, so each position is evaluated
+ * once on load and every error after that is a few multiplies per position.
+ */
+class TexelTuner {
+public:
+    // Per board size outcome of tune().
+    struct Result {
+        size_t positions {0};
+        double k {0.0};
+        double initial_error {0.0};
+        double final_error {0.0};
+        int passes {0};
+    };
+
+    explicit TexelTuner(int threads) : threads_(threads) {}
+
+    void load(const std::string& path, const TacticalEvaluator& evaluator) {
+        std::ifstream in(path);
+        if (!in) throw std::invalid_argument("Cannot open dataset: " + path);
+        std::array<std::vector<RawPosition>, NUM_GEOMETRIES> raw;
+        std::string line;
+        for (int line_number = 1; std::getline(in, line); ++line_number) {
+            line.erase(std::min(line.find('#'), line.size()));
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+            const auto fail = [&](const std::string& why) {
+                return std::invalid_argument(path + ":" + std::to_string(line_number) + ": " + why);
+            };
+            std::istringstream fields(line);
+            int rows = 0, cols = 0, player = 0;
+            RawPosition position;
+            std::string codes;
+            if (!(fields >> rows >> cols >> player >> position.result >> codes)) throw fail("expected rows cols player result codes");
+            if (player != static_cast<int>(Player::SQUARE) && player != static_cast<int>(Player::CIRCLE)) throw fail("invalid player");
+            if (position.result < 0.0 || position.result > 1.0) throw fail("result must be in [0, 1]");
+            if (codes.size() != static_cast<size_t>(rows) * cols) throw fail("expected " + std::to_string(rows * cols) + " piece codes");
+            position.player = static_cast<Player>(player);
+            for (char code : codes) {
+                if (code < '0' || code >= '0' + NUM_PIECE_CODES) throw fail(std::string("invalid piece code '") + code + "'");
+                position.codes.push_back(static_cast<uint8_t>(code - '0'));
+            }
+            dispatch_board_size(rows, cols, [&](auto geometry) {
+                raw[geometry_slot<decltype(geometry)>()].push_back(std::move(position));
+            });
+        }
+
+        const auto extract = [&](auto geometry) {
+            using Geo = decltype(geometry);
+            const auto& positions = raw[geometry_slot<Geo>()];
+            auto& samples = samples_[geometry_slot<Geo>()];
+            samples.resize(positions.size());
+            parallel_for(worker_count(positions.size(), threads_), positions.size(), [&](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const FastBoard board = convert_codes_to_fastboard(positions[i].codes.data(), Geo::rows, Geo::cols);
+                    samples[i] = {evaluator.evaluation_features<Geo>(board, positions[i].player), positions[i].result};
+                }
+            });
+        };
+        extract(SmallBoard{});
+        extract(MediumBoard{});
+        extract(LargeBoard{});
+    }
+
+    template <typename Geo>
+    size_t positions() const { return samples_[geometry_slot<Geo>()].size(); }
+
+    /**
+     * @brief Tunes `weights` in place on this board size's positions. Each pass
+     * tries every weight one step up and down and keeps any improvement; a pass
+     * without one halves the steps, and the search ends once they are all 1.
+     */
+    template <typename Geo>
+    Result tune(EvalWeights& weights, int max_passes) const {
+        const auto& samples = samples_[geometry_slot<Geo>()];
+        Result result;
+        result.positions = samples.size();
+        if (samples.empty()) return result;
+
+        ErrorWorkers workers(samples, worker_count(samples.size(), threads_));
+        result.k = fit_k(workers, weights);
+        result.initial_error = workers.error(weights, result.k);
+        double best = result.initial_error;
+
+        // Fixed-point weights move by 0.1, the near-win bonus by 250 points.
+        std::array<int*, 7> params = {&weights.attack_weight, &weights.river_weight, &weights.defense_weight,
+                                      &weights.friendly_weight, &weights.opponent_weight,
+                                      &weights.near_win_base, &weights.near_win_decay};
+        std::array<int, 7> steps = {10, 10, 10, 10, 10, 250, 250};
+        while (result.passes < max_passes) {
+            ++result.passes;
+            bool improved = false;
+            for (size_t p = 0; p < params.size(); ++p) {
+                for (int direction : {1, -1}) {
+                    const int previous = *params[p];
+                    *params[p] += direction * steps[p];
+                    if (params[p] == &weights.near_win_base || params[p] == &weights.near_win_decay) *params[p] = std::max(0, *params[p]);
+                    const double candidate = workers.error(weights, result.k);
+                    if (candidate < best) {
+                        best = candidate;
+                        improved = true;
+                        break;
+                    }
+                    *params[p] = previous;
+                }
+            }
+            if (improved) continue;
+            if (std::all_of(steps.begin(), steps.end(), [](int step) { return step == 1; })) break;
+            for (int& step : steps) step = std::max(1, step / 2);
+        }
+        result.final_error = best;
+        return result;
+    }
+
+private:
+    struct RawPosition {
+        std::vector<uint8_t> codes;
+        Player player {Player::NONE};
+        double result {0.0};
+    };
+
+    struct Sample {
+        TacticalEvaluator::EvalFeatures features;
+        double result {0.0};
+    };
+
+    static double sigmoid(double k, Score score) { return 1.0 / (1.0 + std::exp(-k * score)); }
+
+    /**
+     * @brief Threads that live for one tune() call, each summing the squared
+     * errors of a fixed slice of the samples. error() wakes them, sums the
+     * first slice itself and waits for the others, so the hundreds of error
+     * evaluations of a tune() start no threads of their own.
+     */
+    class ErrorWorkers {
+    public:
+        ErrorWorkers(const std::vector<Sample>& samples, size_t workers) : samples_(samples), partial_(workers, 0.0) {
+            for (size_t w = 1; w < workers; ++w) threads_.emplace_back([this, w] { run(w); });
         }
-        
-        int best_bonus = 0;
-        for (const auto& adj_pos : adjacent_positions) {
-            int adj_x = adj_pos.first;
-            int adj_y = adj_pos.second;
-            
-            const auto& cell = board[adj_y][adj_x];
-            if (cell.isEmpty() || cell.player != player) continue;
-            
-            //  Calculate Manhattan distance to empty goal cell
-            int manhattan_dist = std::abs(empty_goal_cell.first - adj_x) + 
-                                std::abs(empty_goal_cell.second - adj_y);
-            
-            //  Bonus decreases with distance
-            int bonus = std::max(0, BASE_VALUE - (manhattan_dist * DECAY));
-            best_bonus = std::max(best_bonus, bonus);
+
+        ~ErrorWorkers() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            start_.notify_all();
+            for (auto& thread : threads_) thread.join();
         }
-        
-        return best_bonus;
-    }
-    std::vector<std::pair<int, int>> get_adjacent_to_scoring_zone(
-        Player player, int rows, int cols, 
-        const std::vector<int>& score_cols) const {
-        
-        std::vector<std::pair<int, int>> adjacent_positions;
-        
-        int scoring_row = get_target_row(player, rows);
-        int left_col = *std::min_element(score_cols.begin(), score_cols.end());
-        int right_col = *std::max_element(score_cols.begin(), score_cols.end());
-        
-        // Top row (above scoring area)
-        if (scoring_row - 1 >= 0) {
-            for (int x = left_col; x <= right_col; ++x) {
-                adjacent_positions.emplace_back(x, scoring_row - 1);
+
+        ErrorWorkers(const ErrorWorkers&) = delete;
+        ErrorWorkers& operator=(const ErrorWorkers&) = delete;
+
+        // Mean squared error of the predictions, summed per worker.
+        double error(const EvalWeights& weights, double k) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                weights_ = &weights;
+                k_ = k;
+                pending_ = threads_.size();
+                ++generation_;
             }
+            start_.notify_all();
+            partial_[0] = slice_error(0);
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return pending_ == 0; });
+            return std::accumulate(partial_.begin(), partial_.end(), 0.0) / samples_.size();
         }
-        
-        // Bottom row (below scoring area)
-        if (scoring_row + 1 < rows) {
-            for (int x = left_col; x <= right_col; ++x) {
-                adjacent_positions.emplace_back(x, scoring_row + 1);
+
+    private:
+        void run(size_t worker) {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true) {
+                start_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_) return;
+                seen = generation_;
+                lock.unlock();
+                partial_[worker] = slice_error(worker);
+                lock.lock();
+                if (--pending_ == 0) done_.notify_one();
             }
         }
-        
-        // Left side
-        if (left_col - 1 >= 0) {
-            adjacent_positions.emplace_back(left_col - 1, scoring_row);
+
+        double slice_error(size_t worker) const {
+            const size_t count = samples_.size(), workers = partial_.size();
+            double sum = 0.0;
+            for (size_t i = count * worker / workers; i < count * (worker + 1) / workers; ++i) {
+                const Score score = TacticalEvaluator::combine_components(TacticalEvaluator::components_from(samples_[i].features, *weights_), *weights_);
+                const double diff = samples_[i].result - sigmoid(k_, score);
+                sum += diff * diff;
+            }
+            return sum;
         }
-        
-        // Right side  
-        if (right_col + 1 < cols) {
-            adjacent_positions.emplace_back(right_col + 1, scoring_row);
+
+        const std::vector<Sample>& samples_;
+        std::vector<double> partial_; // One sum per worker; worker 0 is the caller
+        std::vector<std::thread> threads_;
+        std::mutex mutex_;
+        std::condition_variable start_;
+        std::condition_variable done_;
+        const EvalWeights* weights_ {nullptr};
+        double k_ {0.0};
+        uint64_t generation_ {0};
+        size_t pending_ {0};
+        bool stopping_ {false};
+    };
+
+    // K that best maps the current scores to results; ternary search on log10 K.
+    static double fit_k(ErrorWorkers& workers, const EvalWeights& weights) {
+        double low = -8.0, high = -1.0;
+        for (int i = 0; i < 60; ++i) {
+            const double a = low + (high - low) / 3.0, b = high - (high - low) / 3.0;
+            if (workers.error(weights, std::pow(10.0, a)) < workers.error(weights, std::pow(10.0, b))) high = b;
+            else low = a;
         }
-        
-        return adjacent_positions;
-    }
-    void update_evaluation_weights(double friendly_weight, double opponent_weight) {
-        friendly_component_weight = friendly_weight;
-        opponent_component_weight = opponent_weight;
+        return std::pow(10.0, (low + high) / 2.0);
     }
 
-    int evaluate_board_state(const FastBoard& board, Player player, int rows, int cols, const std::vector<int>& score_cols, std::string_view method = "Final_Evaluation") const {
-        auto it = heuristic_methods.find(std::string(method));
-        if (it != heuristic_methods.end()) { 
-            // Lambda now takes FastBoard and Player
-            return it->second(board, player, rows, cols, score_cols);
+    int threads_;
+    std::array<std::vector<Sample>, NUM_GEOMETRIES> samples_; // By geometry_slot
+};
+
+/**
+ * @brief Texel tuning exposed to Python: fits the weights of every board size
+ * found in `dataset` and writes all of them to `output` as an eval params file.
+ * Starts from the built-in weights, or from `initial` when it is given.
+ * The GIL is released while tuning.
+ * @return Mean squared error over all positions after tuning.
+ */
+double tune_eval_params(const std::string& dataset, const std::string& output, int threads, int max_passes, const std::string& initial) {
+    py::gil_scoped_release release;
+    TacticalEvaluator evaluator(1.0, -2.3); // StudentAgent's starting weights
+    if (!initial.empty()) evaluator.load_weights(initial);
+
+    TexelTuner tuner(threads);
+    tuner.load(dataset, evaluator);
+
+    double total_error = 0.0;
+    size_t total_positions = 0;
+    const auto tune = [&](auto geometry) {
+        using Geo = decltype(geometry);
+        EvalWeights weights = evaluator.weights<Geo>();
+        const TexelTuner::Result result = tuner.tune<Geo>(weights, max_passes);
+        if (result.positions == 0) return;
+        evaluator.set_weights<Geo>(weights);
+        std::cout << "Texel " << Geo::rows << "x" << Geo::cols << ": " << result.positions << " positions, K=" << result.k
+                  << ", error " << result.initial_error << " -> " << result.final_error << " in " << result.passes << " passes" << std::endl;
+        total_error += result.final_error * result.positions;
+        total_positions += result.positions;
+    };
+    tune(SmallBoard{});
+    tune(MediumBoard{});
+    tune(LargeBoard{});
+    if (total_positions == 0) throw std::invalid_argument("No positions in dataset: " + dataset);
+
+    evaluator.save_weights(output);
+    return total_error / total_positions;
+}
+
+// ---- EvalCache Class ----
+/**
+ * @brief Fixed-size, direct-mapped cache of static evaluations keyed by the
+ * Zobrist hash. Each hash owns exactly one slot and a newer position simply
+ * overwrites it, so a probe is one index and one full-key compare.
+ *
+ * The search evaluates every child once to order moves and again when it
+ * reaches it as a leaf, and transpositions reach the same leaf many times;
+ * all of those share this one table.
+ */
+class EvalCache {
+public:
+    struct Stats {
+        uint64_t hits {0};
+        uint64_t misses {0};
+    };
+
+    static constexpr int DEFAULT_SIZE_LOG2 = 16; // 65536 entries, 1 MB
+
+    explicit EvalCache(int size_log2 = DEFAULT_SIZE_LOG2)
+        : entries(size_t{1} << size_log2), index_mask((size_t{1} << size_log2) - 1) {}
+
+    bool probe(uint64_t key, Score& score) {
+        const Entry& entry = entries[key & index_mask];
+        if (entry.filled && entry.key == key) {
+            ++stats.hits;
+            score = entry.score;
+            return true;
         }
-        throw std::invalid_argument("Unknown evaluation method: " + std::string(method));
-        return 0; 
+        ++stats.misses;
+        return false;
     }
+
+    void store(uint64_t key, Score score) { entries[key & index_mask] = {key, score, true}; }
+
+    const Stats& statistics() const { return stats; }
+    void reset_statistics() { stats = Stats{}; }
+
 private:
-    double friendly_component_weight;
-    double opponent_component_weight;
-    
-    std::unique_ptr<AttackManager> attack_manager;
-    std::unordered_map<std::string, std::function<int(const FastBoard&, Player, int, int, const std::vector<int>&)>> heuristic_methods;
-    std::unique_ptr<DefenseManager> defense_manager;
-    std::unique_ptr<RiverNetworkManager> river_manager;
+    struct Entry {
+        uint64_t key {0};
+        Score score {0};
+        bool filled {false};
+    };
+
+    std::vector<Entry> entries;
+    size_t index_mask;
+    Stats stats;
 };
 
-// ---- BoardSimulator Class  ----
-class BoardSimulator {
+// ---- TranspositionTable Class ----
+/**
+ * @brief Fixed-size transposition table shared by every search thread and
+ * kept for the whole game (StudentAgent owns it).
+ *
+ * Buckets are one cache line each, holding three entries, so a probe touches
+ * a single line. Entries are written without locks: each one stores
+ * key ^ data ^ move next to its data and move words, and a probe only accepts
+ * an entry whose words XOR back to the probed key. A torn write by another
+ * thread therefore reads as a miss rather than as someone else's result.
+ *
+ * Replacement: an entry for the same key is always overwritten; otherwise
+ * the victim is an empty entry, or else the one with the lowest depth, with
+ * entries from earlier searches (older generations) going first.
+ */
+class TranspositionTable {
 public:
-    static FastBoard get_next_board_state(const FastBoard& board, const Move& move) {
-        FastBoard next_state = board;
-        const int fx = move.from[0], fy = move.from[1];
-        if (move.action == "move") {
-            next_state[move.to[1]][move.to[0]] = std::move(next_state[fy][fx]);
-        } else if (move.action == "push") {
-            next_state[move.pushed_to[1]][move.pushed_to[0]] = std::move(next_state[move.to[1]][move.to[0]]);
-            next_state[move.to[1]][move.to[0]] = std::move(next_state[fy][fx]);
-        } else if (move.action == "flip") {
-            
-            if (next_state[fy][fx].side == Side::STONE) {
-                next_state[fy][fx].side = Side::RIVER;
-                // Convert string orientation from Move struct
-                if (move.orientation) {
-                    next_state[fy][fx].orientation = (*move.orientation == "horizontal") ? Orientation::HORIZONTAL : Orientation::VERTICAL;
-                } else {
-                    next_state[fy][fx].orientation = Orientation::HORIZONTAL; // Default
-                }
-            } else {
-                next_state[fy][fx].side = Side::STONE;
-                next_state[fy][fx].orientation = Orientation::NONE; // Stone has no orientation
+    enum class Flag : uint8_t { EXACT, LOWER_BOUND, UPPER_BOUND };
+
+    struct Entry {
+        Score score;
+        int depth; // Depth remaining from this node
+        Flag flag;
+        PackedMove best_move; // Searched first when this node is reached again
+    };
+
+    static constexpr size_t DEFAULT_SIZE_MB = 64;
+
+    explicit TranspositionTable(size_t megabytes = DEFAULT_SIZE_MB) { resize(megabytes); }
+
+    // Reallocates (and so clears) the table; the bucket count is rounded down to a power of two.
+    void resize(size_t megabytes) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Bucket) <= std::max<size_t>(megabytes, 1) << 20) count *= 2;
+        buckets = std::make_unique<Bucket[]>(count);
+        bucket_mask = count - 1;
+        generation = 0;
+    }
+
+    size_t size_mb() const { return ((bucket_mask + 1) * sizeof(Bucket)) >> 20; }
+
+    void clear() {
+        for (size_t i = 0; i <= bucket_mask; ++i) {
+            for (int slot = 0; slot < BUCKET_ENTRIES; ++slot) {
+                buckets[i].check[slot].store(0, std::memory_order_relaxed);
+                buckets[i].data[slot].store(0, std::memory_order_relaxed);
+                buckets[i].move[slot].store(0, std::memory_order_relaxed);
             }
-            return next_state;
-        } else if (move.action == "rotate") {
-            
-            next_state[fy][fx].orientation = (next_state[fy][fx].orientation == Orientation::HORIZONTAL) ? Orientation::VERTICAL : Orientation::HORIZONTAL;
-            return next_state;
         }
-        // Clear the 'from' square for move/push
-        next_state[fy][fx] = Piece{}; // The new way to clear a cell
-        return next_state;
     }
 
-    static bool is_win_state(const FastBoard& board, int rows, int cols, const std::vector<int>& score_cols) {
-        int circle_score = 0, square_score = 0;
-        const int top_row = top_score_row(), bottom_row = bottom_score_row(rows);
-        for (int x : score_cols) {
-            const auto& top_cell = board[top_row][x];
-            
-            if (!top_cell.isEmpty() && top_cell.player == Player::CIRCLE && top_cell.side == Side::STONE) {
-                if (++circle_score >= score_cols.size()) return true;
+    // Called once per search: entries stored before it become the first to be replaced.
+    void new_search() { generation = (generation + 1) & 0xFF; }
+
+    bool probe(uint64_t key, Entry& entry) const {
+        const Bucket& bucket = buckets[key & bucket_mask];
+        for (int slot = 0; slot < BUCKET_ENTRIES; ++slot) {
+            const uint64_t data = bucket.data[slot].load(std::memory_order_relaxed);
+            const uint32_t move = bucket.move[slot].load(std::memory_order_relaxed);
+            if ((data & USED) == 0 || (bucket.check[slot].load(std::memory_order_relaxed) ^ data ^ move) != key) continue;
+            entry.score = static_cast<Score>(static_cast<uint32_t>(data));
+            entry.depth = static_cast<int8_t>(data >> 32);
+            entry.flag = static_cast<Flag>((data >> 40) & 0xFF);
+            entry.best_move.data = move;
+            return true;
+        }
+        return false;
+    }
+
+    void store(uint64_t key, const Entry& entry) {
+        Bucket& bucket = buckets[key & bucket_mask];
+        int victim = 0;
+        int victim_worth = INT_MAX;
+        for (int slot = 0; slot < BUCKET_ENTRIES; ++slot) {
+            const uint64_t data = bucket.data[slot].load(std::memory_order_relaxed);
+            const uint32_t move = bucket.move[slot].load(std::memory_order_relaxed);
+            if ((data & USED) == 0 || (bucket.check[slot].load(std::memory_order_relaxed) ^ data ^ move) == key) {
+                victim = slot;
+                break;
             }
-            const auto& bottom_cell = board[bottom_row][x];
-            
-            if (!bottom_cell.isEmpty() && bottom_cell.player == Player::SQUARE && bottom_cell.side == Side::STONE) {
-                if (++square_score >= score_cols.size()) return true;
+            // Each search of age counts as much as 8 plies of depth.
+            const int age = (generation - static_cast<int>((data >> 48) & 0xFF)) & 0xFF;
+            const int worth = static_cast<int8_t>(data >> 32) - 8 * age;
+            if (worth < victim_worth) {
+                victim = slot;
+                victim_worth = worth;
             }
         }
-        return false;
+        const uint64_t data = static_cast<uint32_t>(entry.score)
+                            | uint64_t{static_cast<uint8_t>(entry.depth)} << 32
+                            | uint64_t{static_cast<uint8_t>(entry.flag)} << 40
+                            | uint64_t{static_cast<uint8_t>(generation)} << 48
+                            | USED;
+        bucket.check[victim].store(key ^ data ^ entry.best_move.data, std::memory_order_relaxed);
+        bucket.data[victim].store(data, std::memory_order_relaxed);
+        bucket.move[victim].store(entry.best_move.data, std::memory_order_relaxed);
     }
+
+private:
+    static constexpr int BUCKET_ENTRIES = 3;
+    static constexpr uint64_t USED = uint64_t{1} << 56;
+
+    // data: score (bits 0-31), depth (32-39), flag (40-47), generation (48-55), USED.
+    struct alignas(64) Bucket {
+        std::atomic<uint64_t> check[BUCKET_ENTRIES] {};
+        std::atomic<uint64_t> data[BUCKET_ENTRIES] {};
+        std::atomic<uint32_t> move[BUCKET_ENTRIES] {};
+    };
+    static_assert(sizeof(Bucket) == 64, "a bucket must fill exactly one cache line");
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucket_mask {0};
+    int generation {0};
+};
+
+// ---- Search Options ----
+// Search refinements, each of which can be switched off to A/B test it
+// against the plain alpha-beta search (StudentAgent::set_search_options).
+struct SearchOptions {
+    // Principal variation search: every move after the first is searched with
+    // a zero window and re-searched with the full window only if it beats it.
+    bool pvs {true};
+    // Aspiration windows: from depth 2 the root searches a window around the
+    // previous iteration's score and widens it after a fail high or fail low.
+    // Off by default: at depth 3 the score swings too much between
+    // iterations, and the re-searches cost more nodes than the window saves.
+    bool aspiration {false};
+    Score aspiration_window {fixed_weight(5.0)}; // Initial half-width; doubles on every failure
+    // Order interior moves by evaluating every child instead of by the
+    // killer, countermove and history tables (MoveOrdering).
+    bool eval_ordering {false};
+    // Quiescence search: instead of evaluating at depth 0, keep searching
+    // tactical moves (MoveGenerator::is_tactical) until the position is
+    // quiet, for at most quiescence_nodes nodes per leaf.
+    bool quiescence {true};
+    int quiescence_nodes {16};
+    // Null-move pruning (see alpha_beta_search), from depth null_move_min_depth.
+    bool null_move {true};
+    int null_move_reduction {2};
+    int null_move_min_depth {2};
+    // Late move reductions (see alpha_beta_search), from depth lmr_min_depth.
+    bool lmr {true};
+    int lmr_min_depth {2};
+    int lmr_full_moves {4};
+    int lmr_reduction {1};
+    // Deepest iteration; 0 keeps the default of 3 (4 with helper threads).
+    int max_depth {0};
 };
 
 class StudentAgent;
 // ---- SearchManager Class  ----
+// One instantiation per board geometry and heuristic method; StudentAgent::choose picks the geometry once per turn.
+template <typename Geo, typename Evaluator = FinalEvaluation>
 class SearchManager {
 public:
     explicit SearchManager(const StudentAgent& agent_ref);
-    Move find_best_move(const FastBoard& board, int rows, int cols, const std::vector<int>& score_cols, float current_player_time, const std::set<uint64_t>& position_history);
+    // Lazy SMP helper: shares `main`'s Zobrist keys and TT, and gives up when `stop` is set.
+    SearchManager(const SearchManager& main, const std::atomic<bool>* stop);
+    ~SearchManager() { stop_ponder(); }
+
+    // Root moves tied for the best score at the deepest completed iteration.
+    struct RootResult {
+        std::vector<PackedMove> best_moves;
+        int completed_depth {0};
+    };
+
+    // Null only when the side to move has no legal move.
+    PackedMove find_best_move(const FastBoard& board, float current_player_time, const std::set<uint64_t>& position_history);
+    // Iterative deepening from `board` (agent to move) up to max_search_depth, until
+    // time_allowance seconds have passed or stop_flag is set.
+    void search_root(const FastBoard& board, double time_allowance, int max_search_depth, const std::set<uint64_t>& position_history, RootResult& result);
+    // One of the equally best moves at random, or the first legal move if there are none.
+    PackedMove pick_move(const FastBoard& board, const std::vector<PackedMove>& best_action_list);
+    int depth_limit() const;
+
+    // ---- Pondering ----
+    // Searches `board`, the position expected after the opponent's reply, on a
+    // background thread until stop_ponder(). It fills the shared TT either way.
+    void start_ponder(const FastBoard& board, std::set<uint64_t> position_history);
+    void stop_ponder();
+    // Whether the (stopped) ponder search was on this position, agent to move,
+    // and completed every iteration; ponder_result then holds its moves.
+    // Forgets the ponder position either way.
+    bool ponder_hit(uint64_t hash);
+    // The opponent's reply in `board` (opponent to move) that the last search expects, or null.
+    PackedMove expected_reply(const FastBoard& board) const;
+    // Iterative deepening on a helper thread, only to fill the shared TT.
+    void helper_search(const FastBoard& board, int helper_id, int max_depth, const std::set<uint64_t>& position_history);
 
     // ----  TT Helper Methods (MOVED TO PUBLIC) ----
     int get_piece_index(const Piece& piece) const;
-    uint64_t compute_hash(const FastBoard& board, Player player, int rows, int cols) const;
+    uint64_t compute_hash(const FastBoard& board, Player player) const;
+    uint64_t hash_after_move(uint64_t hash, const FastBoard& board, const UndoRecord& undo) const;
+
+    // make_move/unmake_move on the search board, keeping river_network and eval_state in sync.
+    void make_search_move(FastBoard& board, PackedMove move, UndoRecord& undo) const;
+    void unmake_search_move(FastBoard& board, const UndoRecord& undo) const;
 
     struct ScoredMove {
-        Move move;
-        double score;
-        ScoredMove(Move m, double s) : move(std::move(m)), score(s) {}
+        PackedMove move;
+        Score score;
+        ScoredMove(PackedMove m, Score s) : move(m), score(s) {}
     };
 
+    // Move lists of one alpha_beta_search frame. Depth drops on every
+    // recursion, so each depth is in use by at most one frame at a time and
+    // the lists are indexed by it; they keep their capacity from turn to turn.
+    static constexpr int MAX_SEARCH_DEPTH = 64;
+    struct NodeBuffers {
+        std::vector<PackedMove> generated; // StagedMoveGenerator's phases
+        std::vector<PackedMove> ordered;   // Every move, in search order (eval_ordering only)
+        std::vector<ScoredMove> scored;    // One-ply evaluations behind `ordered`
+    };
+    mutable std::array<NodeBuffers, MAX_SEARCH_DEPTH> node_buffers;
+    // Tactical move lists of quiescence_search, indexed by quiescence ply.
+    static constexpr int MAX_QUIESCENCE_DEPTH = 8;
+    mutable std::array<std::vector<PackedMove>, MAX_QUIESCENCE_DEPTH> quiescence_buffers;
+    mutable int quiescence_budget {0}; // Nodes left for the current leaf's quiescence search
+    // Root move lists of find_best_move.
+    std::vector<PackedMove> root_moves;
+    std::vector<ScoredMove> root_scores;
+    std::vector<ScoredMove> root_order;
+
+    mutable MoveOrdering move_ordering;
+    mutable std::array<PackedMove, MoveOrdering::MAX_PLY> played_moves {};
+
     const StudentAgent& agent;
 
-    double alpha_beta_search(const FastBoard& board_state, int depth, double alpha, double beta, Player current_player, int rows, int cols, const std::vector<int>& score_cols, const std::set<uint64_t>& position_history) const;
+    // `ply` counts moves from the root; the move into it is played_moves[ply - 1].
+    Score alpha_beta_search(FastBoard& board_state, uint64_t hash, int depth, Score alpha, Score beta, Player current_player, const std::set<uint64_t>& position_history, int ply = 0) const;
+    // Searches only tactical moves below depth 0, with stand-pat cutoffs, until
+    // the position is quiet or the leaf's quiescence_budget runs out.
+    Score quiescence_search(FastBoard& board_state, uint64_t hash, Score alpha, Score beta, Player current_player, int quiescence_ply) const;
+    // Static evaluation of the search board (whose hash is `hash`), through eval_cache.
+    Score evaluate(const FastBoard& board_state, uint64_t hash) const;
 
     // ----  Transposition Table Data ----
-    enum class TTFlag : uint8_t { EXACT, LOWER_BOUND, UPPER_BOUND };
-    
-    struct TTEntry {
-        double score;
-        int depth; // Depth remaining from this node
-        TTFlag flag;
-    };
-
-    // mutable allows this to be modified by the const alpha_beta_search function
-    mutable std::unordered_map<uint64_t, TTEntry> transposition_table;
+    using TTFlag = TranspositionTable::Flag;
+    using TTEntry = TranspositionTable::Entry;
+
+    // River graph of the search board, updated with every make/unmake.
+    mutable RiverNetwork<Geo> river_network;
+    // Evaluation totals of the search board (agent's view), updated likewise.
+    mutable EvalState<Geo> eval_state;
+
+    // The agent's table: shared with the Lazy SMP helpers and kept across turns.
+    // The eval cache and everything above are per thread.
+    TranspositionTable& transposition_table;
+    mutable EvalCache eval_cache;
+    mutable uint64_t nodes {0}; // alpha_beta_search calls of the current search
+
+    // Set by find_best_move to end the helpers' searches; null on the main thread.
+    const std::atomic<bool>* stop_flag {nullptr};
+    bool stopped() const { return stop_flag && stop_flag->load(std::memory_order_relaxed); }
+    // Lazy SMP helpers of the main thread, created on first use and kept with their buffers and caches.
+    std::vector<std::unique_ptr<SearchManager>> helpers;
+    std::atomic<bool> stop_helpers {false};
+
+    RootResult last_search;
+    // Ponder search state; the thread owns all of it while it runs.
+    RootResult ponder_result;
+    FastBoard ponder_board;
+    std::set<uint64_t> ponder_history;
+    uint64_t ponder_hash {0};
+    std::thread ponder_thread;
+    std::atomic<bool> ponder_stop {false};
     
     // --- STALEMATE FIX: Add PRNG for tie-breaking ---
     mutable std::mt19937 prng; 
@@ -971,6 +2676,7 @@ public:
     // ----  Transposition Table Data ----
 
     // ----  TT Helper Methods ----
+    static constexpr uint64_t ZOBRIST_SEED = 0x5EED0F5A7E5ULL;
     void init_zobrist();
 };
 
@@ -986,44 +2692,127 @@ public:
         opp_side_ = opponent(side_);
     }
 
+    // New weights invalidate every stored score, so the transposition table and eval caches start over.
     void set_heuristic_weights(double weight_a, double weight_b) {
+        stop_pondering();
         heuristic_evaluator.update_evaluation_weights(weight_a, weight_b);
+        transposition_table_.clear();
+        reset_search_contexts();
+    }
+
+    ~StudentAgent() { stop_pondering(); }
+
+    // Threads per search (Lazy SMP); 1 searches on the calling thread only.
+    void set_search_threads(int threads) {
+        if (threads < 1) throw std::invalid_argument("search threads must be at least 1");
+        stop_pondering();
+        search_threads_ = threads;
+    }
+
+    void set_search_options(const SearchOptions& options) {
+        if (options.aspiration_window < 1) throw std::invalid_argument("aspiration window must be at least 1");
+        if (options.quiescence_nodes < 1) throw std::invalid_argument("quiescence nodes must be at least 1");
+        if (options.null_move_reduction < 1 || options.lmr_reduction < 1) throw std::invalid_argument("reductions must be at least 1");
+        if (options.null_move_min_depth < 1 || options.lmr_min_depth < 1 || options.lmr_full_moves < 0) throw std::invalid_argument("invalid null-move or LMR thresholds");
+        if (options.max_depth < 0 || options.max_depth > 32) throw std::invalid_argument("max depth must be between 0 and 32");
+        stop_pondering();
+        search_options_ = options;
+    }
+    const SearchOptions& search_options() const { return search_options_; }
+
+    // Pondering: after each move, search the expected reply while the opponent thinks.
+    void set_ponder(bool enabled) {
+        stop_pondering();
+        ponder_ = enabled;
+    }
+
+    // Replaces the weights of the board sizes listed in an eval params file (see texel.py).
+    void load_eval_params(const std::string& path) {
+        stop_pondering();
+        heuristic_evaluator.load_weights(path);
+        transposition_table_.clear();
+        reset_search_contexts();
+    }
+
+    // Reallocates the transposition table (and so clears it).
+    void set_tt_size_mb(size_t megabytes) {
+        stop_pondering();
+        transposition_table_.resize(megabytes);
     }
+    size_t tt_size_mb() const { return transposition_table_.size_mb(); }
     
     /**
      * @brief Evaluation method exposed to Python.
      * Takes the "slow" board, converts it, and evaluates.
      */
-    double evaluate_with_method(const Board& py_board, int rows, int cols, const std::vector<int>& score_cols, std::string_view method) const {
+    Score evaluate_with_method(const Board& py_board, int rows, int cols, const std::vector<int>& score_cols, std::string_view method) const {
         // Convert slow board to fast board
         FastBoard board = convert_pyboard_to_fastboard(py_board, rows, cols);
-        return heuristic_evaluator.evaluate_board_state(board, side_, rows, cols, score_cols, method);
+        return dispatch_geometry(rows, cols, score_cols, [&](auto geometry) {
+            using Geo = decltype(geometry);
+            return heuristic_evaluator.evaluate_with_method<Geo>(board, side_, method);
+        });
     }
 
+    py::dict evaluate_batch(py::array_t<uint8_t, py::array::c_style | py::array::forcecast> boards,
+                            py::array_t<uint8_t, py::array::c_style | py::array::forcecast> players,
+                            const std::vector<int>& score_cols, int threads) const;
+
+    // Eval cache hits/misses of the most recent choose() call.
+    EvalCache::Stats eval_cache_stats() const { return eval_cache_stats_; }
+
     /**
      * @brief Main "choose" method called by Python.
      * Takes the "slow" board, converts it, runs the search, and returns the best Move.
      */
     Move choose(const Board& py_board, int rows, int cols, const std::vector<int>& score_cols, float current_player_time, float opponent_time) {
+        stop_pondering();
         // --- CONVERSION STEP ---
         // This is the only place the conversion happens.
         FastBoard board = convert_pyboard_to_fastboard(py_board, rows, cols);
         
-        SearchManager search_manager(*this);
-
-        // --- Hash current state and add to history ---
-        uint64_t current_hash = search_manager.compute_hash(board, side_, rows, cols);
-        position_history.insert(current_hash);
-        
+        // Board size is resolved here, once; everything below is specialized for it.
+        return dispatch_geometry(rows, cols, score_cols, [&](auto geometry) {
+            using Geo = decltype(geometry);
+            SearchManager<Geo>& search_manager = search_context<Geo>();
+
+            // --- Hash current state and add to history ---
+            uint64_t current_hash = search_manager.compute_hash(board, side_);
+            position_history.insert(current_hash);
+            
 
-        // All internal logic now uses the FastBoard
-        // Pass the position history to the search manager
-        Move best_action = search_manager.find_best_move(board, rows, cols, score_cols, current_player_time, position_history);
-        
-        return best_action;
+            // All internal logic now uses the FastBoard
+            // Pass the position history to the search manager
+            PackedMove best_action;
+            if (search_manager.ponder_hit(current_hash)) {
+                // We searched this position while the opponent was thinking.
+                std::cout << "--------------- Ponder hit: reusing the depth " << search_manager.ponder_result.completed_depth << " search" << std::endl;
+                best_action = search_manager.pick_move(board, search_manager.ponder_result.best_moves);
+            } else {
+                best_action = search_manager.find_best_move(board, current_player_time, position_history);
+            }
+            eval_cache_stats_ = search_manager.eval_cache.statistics();
+            if (best_action.is_null()) return Move();
+
+            // The position we leave the opponent counts as seen too, so the
+            // search also avoids steering back into it on later turns.
+            UndoRecord undo;
+            BoardSimulator::make_move(board, best_action, undo);
+            position_history.insert(search_manager.compute_hash(board, opp_side_));
+
+            // Think on the opponent's time, about the reply our search expects.
+            if (ponder_) {
+                if (const PackedMove reply = search_manager.expected_reply(board); !reply.is_null()) {
+                    UndoRecord reply_undo;
+                    BoardSimulator::make_move(board, reply, reply_undo);
+                    search_manager.start_ponder(board, position_history);
+                }
+            }
+            return best_action.to_move();
+        });
     }
 private:
-    friend class SearchManager; // Give SearchManager access to private members
+    template <typename Geo, typename Evaluator> friend class SearchManager; // Give SearchManager access to private members
 
     // Store player side in all necessary formats
     std::string side_str_;
@@ -1034,25 +2823,110 @@ private:
     std::mt19937 prng; 
     mutable TacticalEvaluator heuristic_evaluator;
     std::set<uint64_t> position_history;
+    EvalCache::Stats eval_cache_stats_;
+    int search_threads_ {1};
+    bool ponder_ {false};
+    SearchOptions search_options_;
+    // Lives as long as the agent; each search only ages the entries of the previous ones.
+    mutable TranspositionTable transposition_table_;
+
+    // Search state kept for the whole game (Zobrist keys, eval caches, helper
+    // threads' contexts, move buffers), one per board size, made on first use.
+    template <typename Geo>
+    SearchManager<Geo>& search_context() {
+        auto& context = std::get<std::unique_ptr<SearchManager<Geo>>>(search_contexts_);
+        if (!context) context = std::make_unique<SearchManager<Geo>>(*this);
+        return *context;
+    }
+    // Cached evaluations go stale when the weights change.
+    void reset_search_contexts() { search_contexts_ = {}; }
+    // Every ponder search must be stopped before the agent's state changes.
+    void stop_pondering() {
+        std::apply([](auto&... context) { ((context ? context->stop_ponder() : void()), ...); }, search_contexts_);
+    }
+    std::tuple<std::unique_ptr<SearchManager<SmallBoard>>,
+               std::unique_ptr<SearchManager<MediumBoard>>,
+               std::unique_ptr<SearchManager<LargeBoard>>> search_contexts_;
 };
 
 
+/**
+ * @brief Evaluates N boards at once, for offline analysis and weight tuning.
+ *
+ * @param boards  uint8 array of shape (N, rows, cols) holding piece codes:
+ *                0 empty, 1/2/3 square stone/river H/river V, 4/5/6 the same for circle.
+ * @param players uint8 array of N: the side each board is scored for (1 square, 2 circle).
+ * @param threads Worker threads; 0 uses every hardware thread.
+ * @return dict of int32 arrays of N, one per EVAL_BATCH_COLUMNS entry.
+ *
+ * The GIL is released while the boards are evaluated.
+ */
+py::dict StudentAgent::evaluate_batch(py::array_t<uint8_t, py::array::c_style | py::array::forcecast> boards,
+                                      py::array_t<uint8_t, py::array::c_style | py::array::forcecast> players,
+                                      const std::vector<int>& score_cols, int threads) const {
+    if (boards.ndim() != 3) throw std::invalid_argument("boards must have shape (N, rows, cols)");
+    const size_t count = boards.shape(0);
+    const int rows = static_cast<int>(boards.shape(1));
+    const int cols = static_cast<int>(boards.shape(2));
+    if (players.ndim() != 1 || static_cast<size_t>(players.shape(0)) != count) throw std::invalid_argument("players must have shape (N,)");
+
+    const uint8_t* board_data = boards.data();
+    const uint8_t* player_data = players.data();
+    for (size_t i = 0; i < count * rows * cols; ++i) {
+        if (board_data[i] >= NUM_PIECE_CODES) throw std::invalid_argument("Invalid piece code " + std::to_string(board_data[i]));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (player_data[i] != static_cast<uint8_t>(Player::SQUARE) && player_data[i] != static_cast<uint8_t>(Player::CIRCLE)) {
+            throw std::invalid_argument("Invalid player " + std::to_string(player_data[i]));
+        }
+    }
+
+    std::array<py::array_t<int32_t>, EVAL_BATCH_COLUMNS.size()> columns;
+    std::array<int32_t*, EVAL_BATCH_COLUMNS.size()> out;
+    for (size_t c = 0; c < columns.size(); ++c) {
+        columns[c] = py::array_t<int32_t>(count);
+        out[c] = columns[c].mutable_data();
+    }
+
+    dispatch_geometry(rows, cols, score_cols, [&](auto geometry) {
+        using Geo = decltype(geometry);
+        py::gil_scoped_release release;
+        parallel_for(worker_count(count, threads), count, [&](size_t, size_t begin, size_t end) {
+            evaluate_batch_range<Geo>(heuristic_evaluator, board_data, player_data, begin, end, out);
+        });
+    });
+
+    py::dict result;
+    for (size_t c = 0; c < columns.size(); ++c) result[EVAL_BATCH_COLUMNS[c]] = columns[c];
+    return result;
+}
+
+
 // =====================================================================
 // ================= SEARCH MANAGER IMPLEMENTATION =====================
 // =====================================================================
 
 // --- STALEMATE FIX: Initialize PRNG in constructor ---
-SearchManager::SearchManager(const StudentAgent& agent_ref) 
-    : agent(agent_ref), prng(std::random_device{}()) {
+template <typename Geo, typename Evaluator>
+SearchManager<Geo, Evaluator>::SearchManager(const StudentAgent& agent_ref) 
+    : agent(agent_ref), transposition_table(agent_ref.transposition_table_), prng(std::random_device{}()) {
     init_zobrist(); // Initialize Zobrist keys on creation
 }
 
+template <typename Geo, typename Evaluator>
+SearchManager<Geo, Evaluator>::SearchManager(const SearchManager& main, const std::atomic<bool>* stop)
+    : agent(main.agent), transposition_table(main.transposition_table), stop_flag(stop), prng(std::random_device{}()),
+      zobrist_table(main.zobrist_table), zobrist_turn_key(main.zobrist_turn_key) {}
+
 
 /**
  * @brief Initializes the Zobrist hashing table with random 64-bit values.
  */
-void SearchManager::init_zobrist() {
-    std::mt19937_64 prng(std::random_device{}()); // 64-bit Mersenne Twister
+template <typename Geo, typename Evaluator>
+void SearchManager<Geo, Evaluator>::init_zobrist() {
+    // Fixed seed: every SearchManager gets the same keys, so the agent's
+    // transposition table and position history stay valid from turn to turn.
+    std::mt19937_64 prng(ZOBRIST_SEED); // 64-bit Mersenne Twister
     std::uniform_int_distribution<uint64_t> dist(0, std::numeric_limits<uint64_t>::max());
 
     for (int i = 0; i < 17; ++i) { // Max rows
@@ -1068,27 +2942,20 @@ void SearchManager::init_zobrist() {
 /**
  * @brief Maps a Piece object to a unique index (0-6) for the Zobrist table.
  */
-int SearchManager::get_piece_index(const Piece& piece) const {
-    if (piece.isEmpty()) return 0;
-    if (piece.player == Player::SQUARE) {
-        if (piece.side == Side::STONE) return 1;
-        if (piece.orientation == Orientation::HORIZONTAL) return 2;
-        return 3; // Vertical
-    } else { // Player::CIRCLE
-        if (piece.side == Side::STONE) return 4;
-        if (piece.orientation == Orientation::HORIZONTAL) return 5;
-        return 6; // Vertical
-    }
+template <typename Geo, typename Evaluator>
+int SearchManager<Geo, Evaluator>::get_piece_index(const Piece& piece) const {
+    return piece_code(piece); // Same indexing as the FastBoard bitboards
 }
 
 /**
  * @brief Computes the Zobrist hash for a given board state and current player.
  */
-uint64_t SearchManager::compute_hash(const FastBoard& board, Player player, int rows, int cols) const {
+template <typename Geo, typename Evaluator>
+uint64_t SearchManager<Geo, Evaluator>::compute_hash(const FastBoard& board, Player player) const {
     uint64_t hash = 0;
-    for (int y = 0; y < rows; ++y) {
-        for (int x = 0; x < cols; ++x) {
-            hash ^= zobrist_table[y][x][get_piece_index(board[y][x])];
+    for (int y = 0; y < Geo::rows; ++y) {
+        for (int x = 0; x < Geo::cols; ++x) {
+            hash ^= zobrist_table[y][x][board.code_at(cell_index(x, y))];
         }
     }
     // Differentiate the hash based on whose turn it is
@@ -1098,31 +2965,118 @@ uint64_t SearchManager::compute_hash(const FastBoard& board, Player player, int
     return hash;
 }
 
+/**
+ * @brief Updates a hash for a move just made on `board`.
+ * Only the 1-3 cells the move touched are XORed out and back in, plus the turn key.
+ */
+template <typename Geo, typename Evaluator>
+uint64_t SearchManager<Geo, Evaluator>::hash_after_move(uint64_t hash, const FastBoard& board, const UndoRecord& undo) const {
+    auto toggle = [&](int idx, uint8_t old_code) {
+        const auto& keys = zobrist_table[cell_y(idx)][cell_x(idx)];
+        hash ^= keys[old_code] ^ keys[board.code_at(idx)];
+    };
+    const PackedMove move = undo.move;
+    toggle(move.from(), undo.from_code);
+    if (move.action() == ActionType::MOVE || move.action() == ActionType::PUSH) {
+        toggle(move.to(), undo.to_code);
+    }
+    if (move.action() == ActionType::PUSH) {
+        toggle(move.pushed_to(), undo.pushed_code);
+    }
+    return hash ^ zobrist_turn_key;
+}
+
+template <typename Geo, typename Evaluator>
+void SearchManager<Geo, Evaluator>::make_search_move(FastBoard& board, PackedMove move, UndoRecord& undo) const {
+    // Bring the parent's river terms up to date first, so a child only
+    // recomputes the rivers its own move disturbed.
+    eval_state.river_totals(board, river_network);
+    BoardSimulator::make_move(board, move, undo);
+    river_network.apply(board, move);
+    eval_state.apply(board, undo);
+}
+
+template <typename Geo, typename Evaluator>
+void SearchManager<Geo, Evaluator>::unmake_search_move(FastBoard& board, const UndoRecord& undo) const {
+    BoardSimulator::unmake_move(board, undo);
+    river_network.revert();
+    eval_state.revert();
+}
+
 // --- STALEMATE FIX: This function is modified to handle ties randomly ---
-Move SearchManager::find_best_move(const FastBoard& board, int rows, int cols, const std::vector<int>& score_cols, float current_player_time, const std::set<uint64_t>& position_history) {
+template <typename Geo, typename Evaluator>
+PackedMove SearchManager<Geo, Evaluator>::find_best_move(const FastBoard& board, float current_player_time, const std::set<uint64_t>& position_history) {
     const auto start_time = std::chrono::steady_clock::now();
     
     
     double time_allowance = std::min(2.2, current_player_time * 0.85); // Default time
-    const Player opponent_player = agent.opp_side_;
-    int max_search_depth = 3; // Default depth
-    if(rows >= 15){
+    if constexpr (Geo::rows >= 15) {
         time_allowance = std::min(2.5, time_allowance);
     }
 
     if (current_player_time < 8.0) { 
         time_allowance = 0.4; // Panic time
     }
+    const int max_search_depth = depth_limit();
     std::cout<<"------------ Time: " << current_player_time << "s, Allowed: " << time_allowance << "s, Max Depth: " << max_search_depth << std::endl;
-    
+
+    search_root(board, time_allowance, max_search_depth, position_history, last_search);
+
+    std::cout << "--------------- Current Time Used: " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() << "s" << std::endl;
+    std::cout << "--------------- Nodes: " << nodes << ", eval cache: " << eval_cache.statistics().hits << " hits, " << eval_cache.statistics().misses << " misses" << std::endl;
+    return pick_move(board, last_search.best_moves);
+}
+
+template <typename Geo, typename Evaluator>
+int SearchManager<Geo, Evaluator>::depth_limit() const {
+    if (agent.search_options_.max_depth > 0) return agent.search_options_.max_depth;
+    int max_search_depth = 3; // Default depth
+    // Helpers fill the TT ahead of the main thread, which makes one more ply affordable.
+    if (agent.search_threads_ > 1) {
+        ++max_search_depth;
+    }
+    return max_search_depth;
+}
+
+template <typename Geo, typename Evaluator>
+void SearchManager<Geo, Evaluator>::search_root(const FastBoard& board, double time_allowance, int max_search_depth, const std::set<uint64_t>& position_history, RootResult& result) {
+    const auto start_time = std::chrono::steady_clock::now();
+    const Player opponent_player = agent.opp_side_;
+    const int helper_count = std::max(0, agent.search_threads_ - 1);
     
     // --- STALEMATE MOD ---
     // This will hold the list of best moves from the *highest completed depth*.
-    std::vector<Move> best_action_list; 
-    
+    std::vector<PackedMove>& best_action_list = result.best_moves;
+    best_action_list.clear();
+    result.completed_depth = 0;
+
+    transposition_table.new_search();
+    move_ordering.new_search();
+    eval_cache.reset_statistics();
+    std::vector<ScoredMove>& evaluated_moves = root_scores;
+    evaluated_moves.clear();
+
+    // The whole search makes and unmakes moves on this one board.
+    FastBoard search_board = board;
+    river_network.build(search_board);
+    eval_state.build(search_board, agent.side_);
+    const uint64_t root_hash = compute_hash(search_board, agent.side_);
+
+    // --- Lazy SMP ---
+    // Helpers run the same iterative deepening on their own boards, in their
+    // own move order, and share only the TT. Only this thread picks the move.
+    stop_helpers = false;
+    while (static_cast<int>(helpers.size()) < helper_count) {
+        helpers.push_back(std::make_unique<SearchManager>(*this, &stop_helpers));
+    }
+    std::vector<std::thread> helper_threads;
+    for (int id = 1; id <= helper_count; ++id) {
+        helper_threads.emplace_back(&SearchManager::helper_search, helpers[id - 1].get(), std::cref(board), id, max_search_depth, std::cref(position_history));
+    }
 
-    transposition_table.clear(); 
-    std::vector<ScoredMove> evaluated_moves;
+    const SearchOptions& options = agent.search_options_;
+    nodes = 0;
+    Score previous_score = 0; // Root score of the last completed depth
 
     for (int depth = 1; depth <= max_search_depth; ++depth) {
         
@@ -1134,52 +3088,106 @@ Move SearchManager::find_best_move(const FastBoard& board, int rows, int cols, c
         }
         
 
-        double top_score = -std::numeric_limits<double>::infinity();
-        auto legal_moves = MoveGenerator::calculate_possible_actions(board, agent.side_, rows, cols, score_cols);
+        Score top_score = -SCORE_INFINITY;
+        std::vector<PackedMove>& legal_moves = root_moves;
+        legal_moves.clear();
+        MoveGenerator<Geo>::calculate_possible_actions(search_board, agent.side_, legal_moves, &river_network);
 
         if (!evaluated_moves.empty() && depth > 1) {
-             std::sort(legal_moves.begin(), legal_moves.end(), [&](const Move& a, const Move& b) {
-                auto find_score = [&](const Move& m) {
-                    for(const auto& em : evaluated_moves) if(em.move.from == m.from && em.move.to == m.to && em.move.action == m.action) return em.score;
-                    return -std::numeric_limits<double>::infinity();
-                };
-                return find_score(a) > find_score(b);
+            // Best-scoring moves of the previous depth first, each score looked
+            // up by binary search in the move-sorted previous results.
+            std::sort(evaluated_moves.begin(), evaluated_moves.end(), [](const ScoredMove& a, const ScoredMove& b) {
+                return a.move.data < b.move.data;
+            });
+            root_order.clear();
+            for (PackedMove move : legal_moves) {
+                auto it = std::lower_bound(evaluated_moves.begin(), evaluated_moves.end(), move, [](const ScoredMove& scored, PackedMove m) {
+                    return scored.move.data < m.data;
+                });
+                root_order.emplace_back(move, (it != evaluated_moves.end() && it->move == move) ? it->score : -SCORE_INFINITY);
+            }
+            std::stable_sort(root_order.begin(), root_order.end(), [](const ScoredMove& a, const ScoredMove& b) {
+                return a.score > b.score;
             });
+            for (size_t i = 0; i < legal_moves.size(); ++i) legal_moves[i] = root_order[i].move;
         }
 
-        evaluated_moves.clear();
-        
         // --- STALEMATE MOD ---
         // This vector will store all moves that tie for the best score *at this depth*.
-        std::vector<Move> current_depth_best_moves;
+        std::vector<PackedMove> current_depth_best_moves;
         // --- END MOD ---
         
         
         bool did_depth_complete = true; // Assume it completes
-        
-        for (const auto& move : legal_moves) {
-            FastBoard next_board = BoardSimulator::get_next_board_state(board, move);
-            // 1. Get the score of the resulting board state
-            double board_score = alpha_beta_search(next_board, depth - 1, top_score, std::numeric_limits<double>::infinity(), opponent_player, rows, cols, score_cols, position_history);
-            // 3. The final score for this move is the sum of both
-            double final_move_score = board_score ;
-            evaluated_moves.emplace_back(move, final_move_score);
-
-            // --- STALEMATE MOD (CORE LOGIC) ---
-            if (final_move_score > top_score) {
-                // This is a new best score. Clear the old list of ties.
-                top_score = final_move_score;
-                current_depth_best_moves.clear();
-                current_depth_best_moves.push_back(move);
-            } else if (final_move_score == top_score) {
-                // This move is tied for the best. Add it to the list.
-                current_depth_best_moves.push_back(move);
+
+        // --- Aspiration window ---
+        // Scores outside (alpha, beta) are only bounds; a failed window is
+        // widened on the failing side and the whole depth searched again.
+        Score alpha = -SCORE_INFINITY;
+        Score beta = SCORE_INFINITY;
+        int64_t window = options.aspiration_window;
+        const bool use_aspiration = options.aspiration && depth > 1 && result.completed_depth > 0;
+        if (use_aspiration) {
+            alpha = clamp_score(int64_t{previous_score} - window);
+            beta = clamp_score(int64_t{previous_score} + window);
+        }
+
+        while (true) {
+            top_score = -SCORE_INFINITY;
+            current_depth_best_moves.clear();
+            evaluated_moves.clear();
+
+            for (PackedMove move : legal_moves) {
+                // Every move must beat both the window and the best move so far.
+                const Score floor = std::max(alpha, top_score);
+                UndoRecord undo;
+                make_search_move(search_board, move, undo);
+                const uint64_t child_hash = hash_after_move(root_hash, search_board, undo);
+                played_moves[0] = move;
+                // 1. Get the score of the resulting board state
+                Score board_score;
+                if (options.pvs && !evaluated_moves.empty() && floor + 1 < beta) {
+                    board_score = alpha_beta_search(search_board, child_hash, depth - 1, floor, floor + 1, opponent_player, position_history, 1);
+                    if (board_score > floor && board_score < beta) {
+                        board_score = alpha_beta_search(search_board, child_hash, depth - 1, floor, beta, opponent_player, position_history, 1);
+                    }
+                } else {
+                    board_score = alpha_beta_search(search_board, child_hash, depth - 1, floor, beta, opponent_player, position_history, 1);
+                }
+                unmake_search_move(search_board, undo);
+                // 3. The final score for this move is the sum of both
+                Score final_move_score = board_score ;
+                evaluated_moves.emplace_back(move, final_move_score);
+
+                // --- STALEMATE MOD (CORE LOGIC) ---
+                if (final_move_score > top_score) {
+                    // This is a new best score. Clear the old list of ties.
+                    top_score = final_move_score;
+                    current_depth_best_moves.clear();
+                    current_depth_best_moves.push_back(move);
+                } else if (final_move_score == top_score) {
+                    // This move is tied for the best. Add it to the list.
+                    current_depth_best_moves.push_back(move);
+                }
+                // --- END MOD ---
+
+                if (top_score >= beta) break; // Fail high: the window is re-searched below
+
+                // This inner-loop break is still good. It stops a single depth from running too long.
+                // A ponder search is stopped instead, when the opponent has moved.
+                if (stopped() || std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() > time_allowance) {
+                    did_depth_complete = false; // Mark this depth as incomplete
+                    break;
+                }
             }
-            // --- END MOD ---
-            
-            // This inner-loop break is still good. It stops a single depth from running too long.
-            if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() > time_allowance) {
-                did_depth_complete = false; // Mark this depth as incomplete
+
+            if (!did_depth_complete) break;
+            window *= 2;
+            if (top_score >= beta && beta < SCORE_INFINITY) {
+                beta = clamp_score(int64_t{previous_score} + window);
+            } else if (top_score <= alpha && alpha > -SCORE_INFINITY) {
+                alpha = clamp_score(int64_t{previous_score} - window);
+            } else {
                 break;
             }
         }
@@ -1190,24 +3198,30 @@ Move SearchManager::find_best_move(const FastBoard& board, int rows, int cols, c
         if (did_depth_complete && !current_depth_best_moves.empty()) {
             // This depth's results are reliable. Overwrite the list from the previous depth.
             best_action_list = current_depth_best_moves;
+            result.completed_depth = depth;
+            previous_score = top_score;
         } else if (!did_depth_complete) {
             // Time ran out. The results from *this* depth are incomplete and unreliable.
             // We break the loop, and the `best_action_list` from the *previous* depth will be used.
-            std::cout << "---------- Time ran out during depth " << depth << ". Returning move from depth " << (depth-1) << std::endl;
+            if (!stopped()) std::cout << "---------- Time ran out during depth " << depth << ". Returning move from depth " << (depth-1) << std::endl;
             break;
         }
         // --- END MOD ---
     }
-    std::cout << "--------------- Current Time Used: " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() << "s" << std::endl;
-    
+    stop_helpers = true;
+    for (auto& thread : helper_threads) thread.join();
+}
+
+template <typename Geo, typename Evaluator>
+PackedMove SearchManager<Geo, Evaluator>::pick_move(const FastBoard& board, const std::vector<PackedMove>& best_action_list) {
     // --- STALEMATE MOD (FINAL SELECTION) ---
     // We now have a list of best moves from the deepest reliable search.
     if (best_action_list.empty()) {
         // This is a failsafe. If no moves were ever found (e.g., time out on depth 1)
         // just pick the first legal move to avoid crashing.
-        auto all_moves = MoveGenerator::calculate_possible_actions(board, agent.side_, rows, cols, score_cols);
+        auto all_moves = MoveGenerator<Geo>::calculate_possible_actions(board, agent.side_);
         if (!all_moves.empty()) return all_moves[0];
-        return Move(); // Return "none" action
+        return PackedMove(); // Becomes the "none" action
     }
     
     if (best_action_list.size() == 1) {
@@ -1223,21 +3237,158 @@ Move SearchManager::find_best_move(const FastBoard& board, int rows, int cols, c
 }
 
 
-double SearchManager::alpha_beta_search(const FastBoard& board_state, int depth, double alpha, double beta, Player current_player, int rows, int cols, const std::vector<int>& score_cols, const std::set<uint64_t>& position_history) const {
+template <typename Geo, typename Evaluator>
+void SearchManager<Geo, Evaluator>::start_ponder(const FastBoard& board, std::set<uint64_t> position_history) {
+    stop_ponder();
+    ponder_board = board;
+    ponder_hash = compute_hash(board, agent.side_);
+    ponder_history = std::move(position_history);
+    ponder_history.insert(ponder_hash); // As choose() will when this position arrives
+    ponder_stop = false;
+    stop_flag = &ponder_stop;
+    ponder_thread = std::thread([this] {
+        search_root(ponder_board, std::numeric_limits<double>::infinity(), depth_limit(), ponder_history, ponder_result);
+    });
+}
+
+template <typename Geo, typename Evaluator>
+void SearchManager<Geo, Evaluator>::stop_ponder() {
+    if (!ponder_thread.joinable()) return;
+    ponder_stop = true;
+    ponder_thread.join();
+    stop_flag = nullptr;
+}
+
+template <typename Geo, typename Evaluator>
+bool SearchManager<Geo, Evaluator>::ponder_hit(uint64_t hash) {
+    assert(!ponder_thread.joinable());
+    const bool hit = ponder_hash != 0 && hash == ponder_hash && ponder_result.completed_depth >= depth_limit();
+    ponder_hash = 0;
+    return hit;
+}
+
+template <typename Geo, typename Evaluator>
+PackedMove SearchManager<Geo, Evaluator>::expected_reply(const FastBoard& board) const {
+    TTEntry entry;
+    if (!transposition_table.probe(compute_hash(board, agent.opp_side_), entry) || entry.best_move.is_null()) return PackedMove();
+    // A TT move can come from a colliding position; only a legal one is trusted.
+    const auto replies = MoveGenerator<Geo>::calculate_possible_actions(board, agent.opp_side_);
+    return std::find(replies.begin(), replies.end(), entry.best_move) != replies.end() ? entry.best_move : PackedMove();
+}
+
+template <typename Geo, typename Evaluator>
+void SearchManager<Geo, Evaluator>::helper_search(const FastBoard& board, int helper_id, int max_depth, const std::set<uint64_t>& position_history) {
+    FastBoard search_board = board;
+    river_network.build(search_board);
+    eval_state.build(search_board, agent.side_);
+    const uint64_t root_hash = compute_hash(search_board, agent.side_);
+
+    move_ordering.new_search();
+    root_moves.clear();
+    MoveGenerator<Geo>::calculate_possible_actions(search_board, agent.side_, root_moves, &river_network);
+
+    // Odd helpers start a ply deeper, so the threads spread over depths instead
+    // of all searching the same tree; the shuffle varies their move order.
+    for (int depth = 1 + helper_id % 2; depth <= max_depth; ++depth) {
+        std::shuffle(root_moves.begin(), root_moves.end(), prng);
+        Score top_score = -SCORE_INFINITY;
+        for (PackedMove move : root_moves) {
+            UndoRecord undo;
+            make_search_move(search_board, move, undo);
+            played_moves[0] = move;
+            const Score score = alpha_beta_search(search_board, hash_after_move(root_hash, search_board, undo), depth - 1, top_score, SCORE_INFINITY, agent.opp_side_, position_history, 1);
+            unmake_search_move(search_board, undo);
+            if (stopped()) return;
+            top_score = std::max(top_score, score);
+        }
+    }
+}
+
+template <typename Geo, typename Evaluator>
+Score SearchManager<Geo, Evaluator>::quiescence_search(FastBoard& board_state, uint64_t hash, Score alpha, Score beta, Player current_player, int quiescence_ply) const {
+    ++nodes;
+    --quiescence_budget;
+    // Stand pat: the side to move can always decline the tactics.
+    const Score stand_pat = evaluate(board_state, hash);
+    const bool is_maximizing_player = (current_player == agent.side_);
+    if (is_maximizing_player) {
+        if (stand_pat >= beta) return stand_pat;
+        alpha = std::max(alpha, stand_pat);
+    } else {
+        if (stand_pat <= alpha) return stand_pat;
+        beta = std::min(beta, stand_pat);
+    }
+    if (quiescence_budget <= 0 || quiescence_ply >= MAX_QUIESCENCE_DEPTH || BoardSimulator::is_win_state<Geo>(board_state)) return stand_pat;
+
+    std::vector<PackedMove>& moves = quiescence_buffers[quiescence_ply];
+    moves.clear();
+    board_state.pieces_of(current_player).for_each([&](int idx) {
+        MoveGenerator<Geo>::get_displacement_actions(board_state, cell_x(idx), cell_y(idx), current_player, moves, &river_network);
+    });
+    // Our rivers on our score cells flip into scoring stones (river->stone is always legal).
+    (board_state.rivers(current_player) & Geo::own_score_mask(current_player)).for_each([&](int idx) {
+        moves.emplace_back(ActionType::FLIP, idx, idx);
+    });
+    moves.erase(std::remove_if(moves.begin(), moves.end(), [&](PackedMove move) {
+        return !MoveGenerator<Geo>::is_tactical(board_state, move, current_player);
+    }), moves.end());
+    // Goal entries first: they are the likeliest cutoffs.
+    const Bitboard& own_score = Geo::own_score_mask(current_player);
+    std::stable_partition(moves.begin(), moves.end(), [&](PackedMove move) { return own_score.test(move.to()); });
+
+    const Player next_player = opponent(current_player);
+    Score best_score = stand_pat;
+    for (PackedMove move : moves) {
+        if (quiescence_budget <= 0) break;
+        UndoRecord undo;
+        make_search_move(board_state, move, undo);
+        const Score score = quiescence_search(board_state, hash_after_move(hash, board_state, undo), alpha, beta, next_player, quiescence_ply + 1);
+        unmake_search_move(board_state, undo);
+        if (stopped()) return 0;
+        if (is_maximizing_player) {
+            best_score = std::max(best_score, score);
+            alpha = std::max(alpha, score);
+        } else {
+            best_score = std::min(best_score, score);
+            beta = std::min(beta, score);
+        }
+        if (alpha >= beta) break;
+    }
+    return best_score;
+}
+
+template <typename Geo, typename Evaluator>
+Score SearchManager<Geo, Evaluator>::evaluate(const FastBoard& board_state, uint64_t hash) const {
+    Score score;
+    if (eval_cache.probe(hash, score)) return score;
+    score = agent.heuristic_evaluator.evaluate_board_state<Geo, Evaluator>(board_state, agent.side_, &river_network, &eval_state);
+    eval_cache.store(hash, score);
+    return score;
+}
+
+template <typename Geo, typename Evaluator>
+Score SearchManager<Geo, Evaluator>::alpha_beta_search(FastBoard& board_state, uint64_t hash, int depth, Score alpha, Score beta, Player current_player, const std::set<uint64_t>& position_history, int ply) const {
     
+    // A helper told to stop unwinds at once; its partial results are never stored.
+    if (stopped()) return 0;
+
+    ++nodes;
+
     // ---- TT LOOKUP ----
-    double original_alpha = alpha;
-    uint64_t hash = compute_hash(board_state, current_player, rows, cols);
+    Score original_alpha = alpha;
+    Score original_beta = beta;
+    // The hash is carried down incrementally; in debug builds make sure it never drifts.
+    assert(hash == compute_hash(board_state, current_player));
 
     // ----  Repetition Check ----
     if (position_history.count(hash)) {
-        return -500000000.0; // This is a repeated state, avoid it.
+        return -500000000; // This is a repeated state, avoid it.
     }
     // ---- END Repetition Check ----
     
-    auto it = transposition_table.find(hash);
-    if (it != transposition_table.end()) {
-        const TTEntry& entry = it->second;
+    PackedMove hash_move;
+    if (TTEntry entry; transposition_table.probe(hash, entry)) {
+        hash_move = entry.best_move;
         // Use stored entry only if it was from a search at least as deep as the current one
         if (entry.depth >= depth) { 
             if (entry.flag == TTFlag::EXACT) {
@@ -1256,30 +3407,29 @@ double SearchManager::alpha_beta_search(const FastBoard& board_state, int depth,
     }
     // ---- END TT LOOKUP ----
 
-    if (BoardSimulator::is_win_state(board_state, rows, cols, score_cols) || depth == 0) {
-        double score = agent.heuristic_evaluator.evaluate_board_state(board_state, agent.side_, rows, cols, score_cols);
-        
-        // ---- TT STORE (Leaf) ----
+    if (depth == 0 && agent.search_options_.quiescence && !BoardSimulator::is_win_state<Geo>(board_state)) {
+        quiescence_budget = agent.search_options_.quiescence_nodes;
+        const Score score = quiescence_search(board_state, hash, alpha, beta, current_player, 0);
+        if (stopped()) return 0;
+
+        // The score depends on the window, as in a branch.
         TTEntry entry;
         entry.score = score;
-        entry.depth = depth; // Store remaining depth (will be 0 or depth at win)
-        entry.flag = TTFlag::EXACT;
-        transposition_table[hash] = entry;
-        // ---- END TT STORE ----
-        
+        entry.depth = 0;
+        entry.flag = (score <= original_alpha) ? TTFlag::UPPER_BOUND : ((score >= original_beta) ? TTFlag::LOWER_BOUND : TTFlag::EXACT);
+        transposition_table.store(hash, entry);
         return score;
     }
 
-    auto possible_moves = MoveGenerator::calculate_possible_actions(board_state, current_player, rows, cols, score_cols);
-    if (possible_moves.empty()) {
-        double score = agent.heuristic_evaluator.evaluate_board_state(board_state, agent.side_, rows, cols, score_cols);
+    if (BoardSimulator::is_win_state<Geo>(board_state) || depth == 0) {
+        Score score = evaluate(board_state, hash);
         
         // ---- TT STORE (Leaf) ----
         TTEntry entry;
         entry.score = score;
-        entry.depth = depth;
+        entry.depth = depth; // Store remaining depth (will be 0 or depth at win)
         entry.flag = TTFlag::EXACT;
-        transposition_table[hash] = entry;
+        transposition_table.store(hash, entry);
         // ---- END TT STORE ----
         
         return score;
@@ -1287,49 +3437,178 @@ double SearchManager::alpha_beta_search(const FastBoard& board_state, int depth,
 
     //  Compare enums
     const bool is_maximizing_player = (current_player == agent.side_);
+    const SearchOptions& options = agent.search_options_;
+    const PackedMove previous_move = ply > 0 ? played_moves[ply - 1] : PackedMove();
+
+    // ---- Null-Move Pruning ----
+    // If the side to move is already past the window and stays there even
+    // after passing (searched null_move_reduction plies shallower), a real
+    // move would too. Never twice in a row (played_moves holds a null move),
+    // and never near a win, where being made to move can be what loses.
+    if (options.null_move && depth >= options.null_move_min_depth && !previous_move.is_null()
+        && !BoardSimulator::is_near_win<Geo>(board_state)) {
+        const Score static_score = evaluate(board_state, hash);
+        const int null_depth = std::max(0, depth - 1 - options.null_move_reduction);
+        assert(ply < MoveOrdering::MAX_PLY);
+        played_moves[ply] = PackedMove();
+        if (is_maximizing_player && static_score >= beta) {
+            const Score score = alpha_beta_search(board_state, hash ^ zobrist_turn_key, null_depth, beta - 1, beta, opponent(current_player), position_history, ply + 1);
+            if (!stopped() && score >= beta) return score;
+        } else if (!is_maximizing_player && static_score <= alpha) {
+            const Score score = alpha_beta_search(board_state, hash ^ zobrist_turn_key, null_depth, alpha, alpha + 1, opponent(current_player), position_history, ply + 1);
+            if (!stopped() && score <= alpha) return score;
+        }
+    }
 
-    
-    if (depth > 1 && possible_moves.size() > 1) {
-        std::vector<ScoredMove> quickly_scored_moves;
-        quickly_scored_moves.reserve(possible_moves.size());
-        for (const auto& move : possible_moves) {
-            FastBoard next_board = BoardSimulator::get_next_board_state(board_state, move);
-            double quick_score = agent.heuristic_evaluator.evaluate_board_state(next_board, agent.side_, rows, cols, score_cols);
-            quickly_scored_moves.emplace_back(move, quick_score);
-        }
-        std::sort(quickly_scored_moves.begin(), quickly_scored_moves.end(), [is_maximizing_player](const ScoredMove& a, const ScoredMove& b) {
-            return is_maximizing_player ? a.score > b.score : a.score < b.score;
+    // Moves are produced lazily, so a node that cuts off early skips most of the generation.
+    assert(depth < MAX_SEARCH_DEPTH);
+    NodeBuffers& buffers = node_buffers[depth];
+    StagedMoveGenerator<Geo> move_picker(board_state, current_player, hash_move, buffers.generated, &river_network,
+                                         &move_ordering, ply, previous_move);
+    std::vector<PackedMove>& possible_moves = buffers.ordered;
+    possible_moves.clear();
+    size_t next_index = 0;
+    const PackedMove counter = move_ordering.countermove(current_player, previous_move);
+
+    // The A/B alternative to the staged order: a one-ply evaluation of every
+    // child, which needs every move up front. The hash move still goes first.
+    const bool eval_ordering = options.eval_ordering && depth > 1;
+    if (eval_ordering) {
+        std::vector<ScoredMove>& ordering_keys = buffers.scored;
+        ordering_keys.clear();
+        for (PackedMove move = move_picker.next(); !move.is_null(); move = move_picker.next()) {
+            UndoRecord undo;
+            make_search_move(board_state, move, undo);
+            const Score quick_score = evaluate(board_state, hash_after_move(hash, board_state, undo));
+            unmake_search_move(board_state, undo);
+            ordering_keys.emplace_back(move, move == hash_move ? SCORE_INFINITY : (is_maximizing_player ? quick_score : -quick_score));
+        }
+        std::stable_sort(ordering_keys.begin(), ordering_keys.end(), [](const ScoredMove& a, const ScoredMove& b) {
+            return a.score > b.score;
         });
-        possible_moves.clear();
-        for (const auto& scored_move : quickly_scored_moves) {
+        for (const auto& scored_move : ordering_keys) {
             possible_moves.push_back(scored_move.move);
         }
     }
+
+    auto next_move = [&]() -> PackedMove {
+        if (eval_ordering) return (next_index < possible_moves.size()) ? possible_moves[next_index++] : PackedMove();
+        return move_picker.next();
+    };
   
     Player next_player = opponent(current_player); 
-    double score_to_store; // This will hold the final score for this node
+    const bool pvs = options.pvs;
+    // ---- Late Move Reductions ----
+    // Quiet moves ordered after the first lmr_full_moves are unlikely to be
+    // best; they are searched lmr_reduction plies shallower, with a zero
+    // window, and searched again at full depth if they beat it.
+    int searched_moves = 0;
+    auto reduction_for = [&](PackedMove move) {
+        if (!options.lmr || depth < options.lmr_min_depth || searched_moves < options.lmr_full_moves) return 0;
+        if (move == hash_move || move == counter || move_ordering.is_killer(ply, move)) return 0;
+        if (MoveGenerator<Geo>::is_tactical(board_state, move, current_player)) return 0;
+        return std::min(options.lmr_reduction, depth - 1);
+    };
+    Score score_to_store; // This will hold the final score for this node
+    PackedMove best_move;
+    bool has_moves = false;
 
     if (is_maximizing_player) {
-        double max_score = -std::numeric_limits<double>::infinity();
-        for (const auto& move : possible_moves) {
-            FastBoard next_board = BoardSimulator::get_next_board_state(board_state, move);
-            double score = alpha_beta_search(next_board, depth - 1, alpha, beta, next_player, rows, cols, score_cols, position_history);
-            max_score = std::max(max_score, score);
+        Score max_score = -SCORE_INFINITY;
+        for (PackedMove move = next_move(); !move.is_null(); move = next_move()) {
+            const bool first_move = !has_moves;
+            has_moves = true;
+            const int reduction = reduction_for(move);
+            ++searched_moves;
+            UndoRecord undo;
+            make_search_move(board_state, move, undo);
+            const uint64_t child_hash = hash_after_move(hash, board_state, undo);
+            assert(ply < MoveOrdering::MAX_PLY);
+            played_moves[ply] = move;
+            Score score;
+            const bool wide_window = alpha + 1 < beta;
+            if (reduction > 0 || (pvs && !first_move && wide_window)) {
+                // A zero window shows cheaply that the move is no better than alpha:
+                // at reduced depth for a late quiet move (LMR), else at full depth (PVS).
+                score = alpha_beta_search(board_state, child_hash, depth - 1 - reduction, alpha, alpha + 1, next_player, position_history, ply + 1);
+                if (reduction > 0 && score > alpha) {
+                    score = alpha_beta_search(board_state, child_hash, depth - 1, alpha, pvs ? alpha + 1 : beta, next_player, position_history, ply + 1);
+                }
+                if (pvs && wide_window && score > alpha && score < beta) {
+                    score = alpha_beta_search(board_state, child_hash, depth - 1, alpha, beta, next_player, position_history, ply + 1);
+                }
+            } else {
+                score = alpha_beta_search(board_state, child_hash, depth - 1, alpha, beta, next_player, position_history, ply + 1);
+            }
+            unmake_search_move(board_state, undo);
+            if (score > max_score) {
+                max_score = score;
+                best_move = move;
+            }
             alpha = std::max(alpha, max_score);
-            if (alpha >= beta) break;
+            if (alpha >= beta) {
+                move_ordering.record_cutoff(current_player, ply, depth, move, previous_move);
+                break;
+            }
+            if (stopped()) break;
         }
         score_to_store = max_score;
     } else {
-        double min_score = std::numeric_limits<double>::infinity();
-        for (const auto& move : possible_moves) {
-            FastBoard next_board = BoardSimulator::get_next_board_state(board_state, move);
-            double score = alpha_beta_search(next_board, depth - 1, alpha, beta, next_player, rows, cols, score_cols, position_history);
-            min_score = std::min(min_score, score);
+        Score min_score = SCORE_INFINITY;
+        for (PackedMove move = next_move(); !move.is_null(); move = next_move()) {
+            const bool first_move = !has_moves;
+            has_moves = true;
+            const int reduction = reduction_for(move);
+            ++searched_moves;
+            UndoRecord undo;
+            make_search_move(board_state, move, undo);
+            const uint64_t child_hash = hash_after_move(hash, board_state, undo);
+            assert(ply < MoveOrdering::MAX_PLY);
+            played_moves[ply] = move;
+            Score score;
+            const bool wide_window = alpha + 1 < beta;
+            if (reduction > 0 || (pvs && !first_move && wide_window)) {
+                // A zero window shows cheaply that the move is no better than beta:
+                // at reduced depth for a late quiet move (LMR), else at full depth (PVS).
+                score = alpha_beta_search(board_state, child_hash, depth - 1 - reduction, beta - 1, beta, next_player, position_history, ply + 1);
+                if (reduction > 0 && score < beta) {
+                    score = alpha_beta_search(board_state, child_hash, depth - 1, pvs ? beta - 1 : alpha, beta, next_player, position_history, ply + 1);
+                }
+                if (pvs && wide_window && score < beta && score > alpha) {
+                    score = alpha_beta_search(board_state, child_hash, depth - 1, alpha, beta, next_player, position_history, ply + 1);
+                }
+            } else {
+                score = alpha_beta_search(board_state, child_hash, depth - 1, alpha, beta, next_player, position_history, ply + 1);
+            }
+            unmake_search_move(board_state, undo);
+            if (score < min_score) {
+                min_score = score;
+                best_move = move;
+            }
             beta = std::min(beta, min_score);
-            if (beta <= alpha) break;
+            if (beta <= alpha) {
+                move_ordering.record_cutoff(current_player, ply, depth, move, previous_move);
+                break;
+            }
+            if (stopped()) break;
         }
         score_to_store = min_score;
     }
+    if (stopped()) return 0;
+
+    if (!has_moves) {
+        Score score = evaluate(board_state, hash);
+        
+        // ---- TT STORE (Leaf) ----
+        TTEntry entry;
+        entry.score = score;
+        entry.depth = depth;
+        entry.flag = TTFlag::EXACT;
+        transposition_table.store(hash, entry);
+        // ---- END TT STORE ----
+        
+        return score;
+    }
 
     // ---- TT STORE (Branch) ----
     TTEntry entry;
@@ -1338,14 +3617,15 @@ double SearchManager::alpha_beta_search(const FastBoard& board_state, int depth,
     if (score_to_store <= original_alpha) {
         // We failed low (score <= alpha), so this is an UPPER_BOUND
         entry.flag = TTFlag::UPPER_BOUND;
-    } else if (score_to_store >= beta) {
+    } else if (score_to_store >= original_beta) {
         // We failed high (score >= beta), so this is a LOWER_BOUND
         entry.flag = TTFlag::LOWER_BOUND;
     } else {
         // The score is between alpha and beta, so it's EXACT
         entry.flag = TTFlag::EXACT;
     }
-    transposition_table[hash] = entry;
+    entry.best_move = best_move;
+    transposition_table.store(hash, entry);
     // ---- END TT STORE ----
 
     return score_to_store;
@@ -1359,10 +3639,48 @@ PYBIND11_MODULE(student_agent_module, m) {
         .def_readonly("pushed_to", &Move::pushed_to)
         .def_readonly("orientation", &Move::orientation);
 
+    py::class_<EvalCache::Stats>(m, "EvalCacheStats")
+        .def_readonly("hits", &EvalCache::Stats::hits)
+        .def_readonly("misses", &EvalCache::Stats::misses);
+
+    py::class_<SearchOptions>(m, "SearchOptions")
+        .def(py::init<>())
+        .def_readwrite("pvs", &SearchOptions::pvs)
+        .def_readwrite("aspiration", &SearchOptions::aspiration)
+        .def_readwrite("aspiration_window", &SearchOptions::aspiration_window)
+        .def_readwrite("eval_ordering", &SearchOptions::eval_ordering)
+        .def_readwrite("quiescence", &SearchOptions::quiescence)
+        .def_readwrite("quiescence_nodes", &SearchOptions::quiescence_nodes)
+        .def_readwrite("null_move", &SearchOptions::null_move)
+        .def_readwrite("null_move_reduction", &SearchOptions::null_move_reduction)
+        .def_readwrite("null_move_min_depth", &SearchOptions::null_move_min_depth)
+        .def_readwrite("lmr", &SearchOptions::lmr)
+        .def_readwrite("lmr_min_depth", &SearchOptions::lmr_min_depth)
+        .def_readwrite("lmr_full_moves", &SearchOptions::lmr_full_moves)
+        .def_readwrite("lmr_reduction", &SearchOptions::lmr_reduction)
+        .def_readwrite("max_depth", &SearchOptions::max_depth);
+
     py::class_<StudentAgent>(m, "StudentAgent")
         .def(py::init<std::string>())
         .def("choose", &StudentAgent::choose)
         .def("set_heuristic_weights", &StudentAgent::set_heuristic_weights)
-        .def("evaluate_with_method", &StudentAgent::evaluate_with_method);
+        .def("evaluate_with_method", &StudentAgent::evaluate_with_method)
+        .def("evaluate_batch", &StudentAgent::evaluate_batch, py::arg("boards"), py::arg("players"), py::arg("score_cols"), py::arg("threads") = 1)
+        .def("eval_cache_stats", &StudentAgent::eval_cache_stats)
+        .def("load_eval_params", &StudentAgent::load_eval_params)
+        .def("set_search_threads", &StudentAgent::set_search_threads)
+        .def("set_ponder", &StudentAgent::set_ponder)
+        .def("set_search_options", &StudentAgent::set_search_options)
+        .def("search_options", &StudentAgent::search_options)
+        .def("set_tt_size_mb", &StudentAgent::set_tt_size_mb)
+        .def("tt_size_mb", &StudentAgent::tt_size_mb);
+
+    // Move generation check, used by perft.py
+    m.def("perft", &perft);
+    m.def("perft_divide", &perft_divide);
+
+    // Weight tuning, used by texel.py
+    m.def("tune_eval_params", &tune_eval_params, py::arg("dataset"), py::arg("output"), py::arg("threads") = 0,
+          py::arg("max_passes") = 100, py::arg("initial") = "");
 }
 
@@ -1,3 +1,4 @@
+import os
 import build.student_agent_module as student_agent
 from abc import ABC, abstractmethod
 from typing import List, Dict, Any, Optional
@@ -58,6 +59,41 @@ def is_own_score_cell(x: int, y: int, player: str, rows: int, cols: int, score_c
     else:
         return (y == bottom_score_row(rows)) and (x in score_cols)
 
+# Piece codes used by StudentAgent.evaluate_batch (same order as the C++ PieceCode enum)
+PIECE_CODES = {
+    ("square", "stone", None): 1, ("square", "river", "horizontal"): 2, ("square", "river", "vertical"): 3,
+    ("circle", "stone", None): 4, ("circle", "river", "horizontal"): 5, ("circle", "river", "vertical"): 6,
+}
+PLAYER_CODES = {"square": 1, "circle": 2}
+
+# Tuned evaluation weights written by texel.py, loaded by every StudentAgent when present
+EVAL_PARAMS_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "eval_params.txt")
+# Search threads per move (Lazy SMP); 1 keeps the single-threaded search
+SEARCH_THREADS = int(os.environ.get("STUDENT_AGENT_THREADS", "1"))
+# Transposition table size in MB; None keeps the module's default
+TT_SIZE_MB = int(os.environ["STUDENT_AGENT_TT_MB"]) if "STUDENT_AGENT_TT_MB" in os.environ else None
+# Search the expected reply on the opponent's time (STUDENT_AGENT_PONDER=1)
+PONDER = os.environ.get("STUDENT_AGENT_PONDER", "0") == "1"
+# Search option overrides for A/B tests, e.g. STUDENT_AGENT_SEARCH="pvs=0,aspiration=1,aspiration_window=300"
+SEARCH_OPTIONS = dict(item.split("=", 1) for item in os.environ.get("STUDENT_AGENT_SEARCH", "").split(",") if item)
+
+def search_options(overrides: Dict[str, str]) -> "student_agent.SearchOptions":
+    """Default SearchOptions with the given fields replaced (integers; 0/1 for switches)."""
+    options = student_agent.SearchOptions()
+    for name, value in overrides.items():
+        if not hasattr(options, name):
+            raise ValueError(f"unknown search option: {name}")
+        setattr(options, name, type(getattr(options, name))(int(value)))
+    return options
+
+def encode_board(board: List[List[Any]]) -> List[List[int]]:
+    """Encode an engine board as piece codes (0 = empty) for evaluate_batch.
+
+    Stack several with numpy.asarray([...], dtype=numpy.uint8) to get the (N, rows, cols) input.
+    """
+    return [[0 if cell is None else PIECE_CODES[(cell.owner, cell.side, cell.orientation if cell.side == "river" else None)]
+             for cell in row] for row in board]
+
 class BaseAgent(ABC):
     """
     Abstract base class for all agents.
@@ -76,6 +112,13 @@ class StudentAgent(BaseAgent):
         super().__init__(player)
 
         self.agent = student_agent.StudentAgent(player)
+        if os.path.exists(EVAL_PARAMS_FILE):
+            self.agent.load_eval_params(EVAL_PARAMS_FILE)
+        self.agent.set_search_threads(SEARCH_THREADS)
+        if TT_SIZE_MB is not None:
+            self.agent.set_tt_size_mb(TT_SIZE_MB)
+        self.agent.set_ponder(PONDER)
+        self.agent.set_search_options(search_options(SEARCH_OPTIONS))
     def choose(self, game_state: List[List[Any]], rows: int, cols: int,score_cols: List[int], current_player_time: float, opponent_time: float) -> Optional[Dict[str, Any]]:
         cpp_board: List[List[Dict[str, str]]] = []
         for row in game_state:
@@ -0,0 +1,133 @@
+"""
+Texel tuning of the C++ evaluation weights.
+
+Plays games between agents (see agent.get_agent), records every position with
+the final result from the side to move's point of view, and fits the
+per-board-size weights of the C++ evaluation to those results
+(student_agent_module.tune_eval_params). The tuned weights are written as an
+eval params file; student_agent_cpp.StudentAgent loads eval_params.txt from
+its own directory when it exists.
+
+    python texel.py generate --games 200 --board-size small   # appends to texel_positions.txt
+    python texel.py tune                                     # writes eval_params.txt
+    python texel.py tune --initial eval_params.txt           # continue from earlier weights
+
+Dataset format, one position per line: "rows cols player result codes", with
+player 1 (square) or 2 (circle) to move, result 1 / 0.5 / 0 for that player,
+and codes the piece codes of student_agent_cpp.encode_board as one string of
+digits, row by row.
+"""
+
+import argparse
+import random
+import sys
+import time
+from typing import List, Optional, Tuple
+
+import gameEngine as engine
+from agent import get_agent
+from student_agent_cpp import PLAYER_CODES, encode_board
+
+DEFAULT_DATASET = "texel_positions.txt"
+DEFAULT_PARAMS = "eval_params.txt"
+BOARD_SIZES = {"small": (13, 12), "medium": (15, 14), "large": (17, 16)}
+MAX_TURNS = 1000  # Games still running after this many turns count as draws
+
+# ---------------- Dataset ----------------
+def encode_position(board, player: str) -> str:
+    codes = "".join(str(code) for row in encode_board(board) for code in row)
+    return f"{len(board)} {len(board[0])} {PLAYER_CODES[player]} {{result}} {codes}"
+
+def random_move(board, player: str, rows: int, cols: int, score_cols: List[int], rng: random.Random) -> Optional[dict]:
+    """A random move the engine accepts (generate_all_moves may list illegal ones)."""
+    moves = engine.generate_all_moves(board, player, rows, cols, score_cols)
+    rng.shuffle(moves)
+    for move in moves:
+        trial = [[cell.copy() if cell else None for cell in row] for row in board]
+        if engine.validate_and_apply_move(trial, move, player, rows, cols, score_cols)[0]:
+            return move
+    return None
+
+def play_game(rows: int, cols: int, circle: str, square: str, time_per_player: float,
+              random_plies: int, rng: random.Random) -> Tuple[List[Tuple[str, str]], Optional[str]]:
+    """Plays one game; returns the (position, side to move) pairs and the winner (None for a draw)."""
+    score_cols = engine.score_cols_for(cols)
+    board = engine.default_start_board(rows, cols)
+    agents = {"circle": get_agent("circle", circle), "square": get_agent("square", square)}
+    timers = {"circle": time_per_player, "square": time_per_player}
+    positions = []
+    player = "circle"
+    for turn in range(MAX_TURNS):
+        winner = engine.check_win(board, rows, cols, score_cols)
+        if winner:
+            return positions, winner
+        positions.append((encode_position(board, player), player))
+
+        if turn < random_plies:
+            # Random opening so games from the same agents differ
+            move = random_move(board, player, rows, cols, score_cols, rng)
+        else:
+            start = time.time()
+            move = agents[player].choose(board, rows, cols, score_cols, timers[player], timers[engine.opponent(player)])
+            timers[player] -= time.time() - start
+            if timers[player] <= 0:
+                return positions, engine.opponent(player)
+        if move is None or not engine.validate_and_apply_move(board, move, player, rows, cols, score_cols)[0]:
+            return positions, engine.opponent(player)
+        player = engine.opponent(player)
+    return positions, None
+
+def generate(args) -> int:
+    rng = random.Random(args.seed)
+    rows, cols = BOARD_SIZES[args.board_size]
+    written = 0
+    with open(args.dataset, "a", encoding="utf-8") as out:
+        for game in range(args.games):
+            positions, winner = play_game(rows, cols, args.circle, args.square, args.time, args.random_plies, rng)
+            for line, player in positions[args.skip:]:
+                result = 0.5 if winner is None else (1 if winner == player else 0)
+                out.write(line.format(result=result) + "\n")
+                written += 1
+            out.flush()
+            print(f"game {game + 1}/{args.games}: {winner or 'draw'} after {len(positions)} turns")
+    print(f"{written} positions appended to {args.dataset}")
+    return 0
+
+# ---------------- Tuning ----------------
+def tune(args) -> int:
+    import build.student_agent_module as student_agent
+
+    start = time.perf_counter()
+    error = student_agent.tune_eval_params(args.dataset, args.output, threads=args.threads,
+                                           max_passes=args.max_passes, initial=args.initial or "")
+    print(f"mean squared error {error:.6f} in {time.perf_counter() - start:.1f}s; weights written to {args.output}")
+    return 0
+
+# ---------------- Main ----------------
+def main() -> int:
+    ap = argparse.ArgumentParser(description="Texel tuning of the C++ evaluation weights")
+    sub = ap.add_subparsers(dest="command", required=True)
+
+    gen = sub.add_parser("generate", help="play games and append their positions to the dataset")
+    gen.add_argument("--dataset", default=DEFAULT_DATASET)
+    gen.add_argument("--games", type=int, default=50)
+    gen.add_argument("--board-size", choices=sorted(BOARD_SIZES), default="small")
+    gen.add_argument("--circle", default="student_cpp", help="agent strategy for circle")
+    gen.add_argument("--square", default="student_cpp", help="agent strategy for square")
+    gen.add_argument("--time", type=float, default=60.0, help="seconds per player per game")
+    gen.add_argument("--random-plies", type=int, default=8, help="random opening moves per game")
+    gen.add_argument("--skip", type=int, default=8, help="opening positions left out of the dataset")
+    gen.add_argument("--seed", type=int, default=1)
+
+    tun = sub.add_parser("tune", help="fit the weights to the dataset")
+    tun.add_argument("--dataset", default=DEFAULT_DATASET)
+    tun.add_argument("--output", default=DEFAULT_PARAMS)
+    tun.add_argument("--initial", default=None, help="eval params file to start from")
+    tun.add_argument("--threads", type=int, default=0, help="0 uses every hardware thread")
+    tun.add_argument("--max-passes", type=int, default=100)
+
+    args = ap.parse_args()
+    return generate(args) if args.command == "generate" else tune(args)
+
+if __name__ == "__main__":
+    sys.exit(main())